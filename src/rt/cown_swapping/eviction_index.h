@@ -0,0 +1,142 @@
+#pragma once
+
+#include <cstddef>
+#include <mutex>
+#include <random>
+#include <utility>
+#include <vector>
+
+namespace verona::rt
+{
+    class Cown;
+}
+
+namespace verona::cpp
+{
+    using cown_pair = std::pair<verona::rt::Cown *, size_t>;
+
+    /// Set of cowns that are in memory and can be evicted, with constant time victim selection.
+    ///
+    /// The set is a dense vector, so removing a victim swaps it with the last element. LRU and LFU are approximated
+    /// by sampling a fixed number of cowns and evicting the one with the smallest key, rather than ordering every
+    /// cown by its access metadata. This keeps the scheduler's updates to that metadata free of any lock shared
+    /// with the index. Rotational policies use a clock hand over the vector.
+    ///
+    /// The vector is only touched by the memory thread. Cowns registered or fetched from other threads are added
+    /// to a small inbox, which is drained before each selection.
+    class EvictionIndex
+    {
+    private:
+        /// Cowns compared per LRU or LFU selection.
+        static constexpr size_t SAMPLES = 16;
+
+        std::vector<cown_pair> resident;
+        size_t hand{0};
+        std::minstd_rand rng;
+
+        std::mutex inbox_mutex;
+        std::vector<cown_pair> inbox;
+
+        cown_pair take(size_t i)
+        {
+            auto cown = resident[i];
+            resident[i] = resident.back();
+            resident.pop_back();
+
+            if (hand >= resident.size())
+                hand = 0;
+
+            return cown;
+        }
+
+    public:
+        /// Adds a cown back to the index. Can be called from any thread.
+        void insert(cown_pair cown)
+        {
+            std::lock_guard<std::mutex> lock(inbox_mutex);
+            inbox.push_back(cown);
+        }
+
+        /// Moves cowns added by `insert` into the index.
+        void drain()
+        {
+            std::lock_guard<std::mutex> lock(inbox_mutex);
+            resident.insert(resident.end(), inbox.begin(), inbox.end());
+            inbox.clear();
+        }
+
+        bool empty() const
+        {
+            return resident.empty();
+        }
+
+        size_t size() const
+        {
+            return resident.size();
+        }
+
+        /// Removes the sampled cown with the smallest `key`, or returns null if the index is empty.
+        template<typename Key>
+        cown_pair pick_sampled(Key key)
+        {
+            if (resident.empty())
+                return {nullptr, 0};
+
+            if (resident.size() <= SAMPLES)
+            {
+                size_t best = 0;
+                for (size_t i = 1; i < resident.size(); ++i)
+                {
+                    if (key(resident[i].first) < key(resident[best].first))
+                        best = i;
+                }
+                return take(best);
+            }
+
+            size_t best = rng() % resident.size();
+            auto best_key = key(resident[best].first);
+            for (size_t s = 1; s < SAMPLES; ++s)
+            {
+                size_t i = rng() % resident.size();
+                auto k = key(resident[i].first);
+                if (k < best_key)
+                {
+                    best = i;
+                    best_key = k;
+                }
+            }
+
+            return take(best);
+        }
+
+        /// Removes a uniformly random cown, or returns null if the index is empty.
+        cown_pair pick_random()
+        {
+            if (resident.empty())
+                return {nullptr, 0};
+
+            return take(rng() % resident.size());
+        }
+
+        /// Removes the cown under the clock hand, or returns null if the index is empty. `skip` is given each cown
+        /// under the hand, and returning true gives it a second chance. After a full revolution the next cown is
+        /// taken regardless.
+        template<typename Skip>
+        cown_pair pick_clock(Skip skip)
+        {
+            if (resident.empty())
+                return {nullptr, 0};
+
+            for (size_t checked = 0; checked < resident.size(); ++checked)
+            {
+                if (!skip(resident[hand].first))
+                    break;
+
+                if (++hand == resident.size())
+                    hand = 0;
+            }
+
+            return take(hand);
+        }
+    };
+} // namespace verona::cpp
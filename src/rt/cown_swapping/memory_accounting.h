@@ -0,0 +1,127 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <optional>
+
+#include <snmalloc/override/malloc-extensions.cc>
+
+namespace verona::cpp
+{
+    /// Memory figures the swapping thread bases its decisions on.
+    ///
+    /// Resident bytes are the sizes of registered cowns that are in memory, maintained incrementally as cowns are
+    /// registered, swapped out and fetched. The allocator's figure, from snmalloc's statistics, covers the runtime's
+    /// own allocations and is only sampled once per interval. Usage is their sum, so it follows evictions and
+    /// fetches between samples.
+    ///
+    /// An update to the resident bytes that takes usage above the high watermark wakes the thread waiting in
+    /// `wait_until`. Growth of the allocator's figure is only seen when it is next sampled, so the waiting thread
+    /// must still wake for each sample, see `next_sample`.
+    class MemoryAccounting
+    {
+    private:
+        const uint64_t high_watermark;
+
+        std::atomic<int64_t> resident{0};
+        std::atomic<uint64_t> allocated{0};
+
+        std::atomic<std::chrono::steady_clock::rep> sample_interval;
+        /// Unset until the first sample.
+        std::optional<std::chrono::steady_clock::time_point> last_sample;
+
+        std::mutex mutex;
+        std::condition_variable cv;
+        bool woken{false};
+
+        void check_watermark(int64_t new_resident, int64_t old_resident)
+        {
+            if (high_watermark == 0)
+                return;
+
+            auto base = (int64_t)allocated.load(std::memory_order_relaxed);
+            if (base + old_resident <= (int64_t)high_watermark && base + new_resident > (int64_t)high_watermark)
+                wake();
+        }
+
+    public:
+        /// @param high_watermark Usage above which the waiting thread is woken. Zero disables wakeups.
+        MemoryAccounting(uint64_t high_watermark, std::chrono::steady_clock::duration sample_interval)
+        : high_watermark(high_watermark), sample_interval(sample_interval.count())
+        {}
+
+        void add_resident(size_t bytes)
+        {
+            auto old_resident = resident.fetch_add((int64_t)bytes, std::memory_order_relaxed);
+            check_watermark(old_resident + (int64_t)bytes, old_resident);
+        }
+
+        void remove_resident(size_t bytes)
+        {
+            resident.fetch_sub((int64_t)bytes, std::memory_order_relaxed);
+        }
+
+        void clear_resident()
+        {
+            resident.store(0, std::memory_order_relaxed);
+        }
+
+        uint64_t get_resident()
+        {
+            auto bytes = resident.load(std::memory_order_relaxed);
+            return bytes < 0 ? 0 : (uint64_t)bytes;
+        }
+
+        void set_sample_interval(std::chrono::steady_clock::duration interval)
+        {
+            sample_interval.store(interval.count(), std::memory_order_relaxed);
+        }
+
+        /// Refresh the allocator's figure if the sample interval has passed. Only called by the swapping thread.
+        void sample(std::chrono::steady_clock::time_point now)
+        {
+            auto interval = std::chrono::steady_clock::duration(sample_interval.load(std::memory_order_relaxed));
+            if (last_sample && now - *last_sample < interval)
+                return;
+
+            malloc_info_v1 info;
+            get_malloc_info_v1(&info);
+            allocated.store(info.current_memory_usage, std::memory_order_relaxed);
+            last_sample = now;
+        }
+
+        /// @return When the allocator's figure is next due to be sampled.
+        std::chrono::steady_clock::time_point next_sample(std::chrono::steady_clock::time_point now)
+        {
+            if (!last_sample)
+                return now;
+
+            return *last_sample + std::chrono::steady_clock::duration(sample_interval.load(std::memory_order_relaxed));
+        }
+
+        uint64_t get_usage()
+        {
+            return allocated.load(std::memory_order_relaxed) + get_resident();
+        }
+
+        /// Block until usage crosses the high watermark, `wake` is called, or `deadline` has passed.
+        void wait_until(std::chrono::steady_clock::time_point deadline)
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            cv.wait_until(lock, deadline, [this]() { return woken; });
+            woken = false;
+        }
+
+        void wake()
+        {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                woken = true;
+            }
+            cv.notify_one();
+        }
+    };
+} // namespace verona::cpp
@@ -2,6 +2,8 @@
 
 #include "debug/logging.h"
 #include "cpp/cown_swapper.h"
+#include "eviction_index.h"
+#include "memory_accounting.h"
 
 #include <iostream>
 #include <thread>
@@ -9,9 +11,8 @@
 #include <queue>
 #include <cmath>
 
-#include <malloc.h>
 #include <unordered_map>
-#include <snmalloc/override/malloc-extensions.cc>
+#include <unordered_set>
 
 #ifdef _WIN32 // Windows-specific headers
 #include <Windows.h>
@@ -50,16 +51,15 @@ namespace verona::cpp
         size_t memory_measure_count{0};
         bool print_memory = false;
 
+        // Every registered cown, whether in memory or on disk.
         std::mutex cowns_mutex;
-        std::vector<cown_pair> cowns;
-        // Flags indicating whether cowns are on disk or not.
-        std::unordered_map<Cown*, bool> cown_flags{};
+        std::unordered_set<Cown*> cowns;
 
-        // Total siize of all cowns
-        uint64_t cowns_size_bytes = 0;
+        // Registered cowns that are in memory and not being swapped.
+        EvictionIndex index;
 
-        // Next cown to be swapped for rotational algorithms.
-        size_t next_cown{0};
+        // Resident bytes of cowns in memory, and the allocator's usage.
+        MemoryAccounting accounting;
 
         std::thread monitoring_thread;
 
@@ -70,6 +70,13 @@ namespace verona::cpp
         // Number of swaps currently scheduled or running.
         std::atomic_uint64_t swaps_running{0};
 
+        // Period of the coarse clock used for cown access times while evicting. Otherwise the thread only wakes,
+        // and the clock only advances, once per sample interval.
+        static constexpr auto ACCESS_EPOCH_PERIOD = std::chrono::milliseconds(1);
+
+        // Default period between samples of the allocator's usage.
+        static constexpr auto SAMPLE_INTERVAL = std::chrono::milliseconds(10);
+
 #ifdef USE_SYSTEMATIC_TESTING
         std::atomic_bool registered{false};
         size_t nothing_loop_count{0};
@@ -78,74 +85,36 @@ namespace verona::cpp
 
     private:
 
-        int32_t get_next_cown()
+        /// @return The next cown to evict, or null if there is none or the thread is stopping.
+        cown_pair get_next_cown()
         {
-            size_t ret;
+            if (!keep_monitoring)
+                return {nullptr, 0};
 
-            do
+            switch (swapping_algo)
             {
-                std::lock_guard<std::mutex> lock(cowns_mutex);
-                switch (swapping_algo)
-                {
-                    case SwappingAlgo::LFU:
-                        for (size_t i = 0; i < cowns.size(); ++i)
-                        {
-                            if (cown_flags[cowns[i].first])
-                            {
-                                next_cown = CownSwapper::get_num_accesses(cowns[i].first) 
-                                            <= CownSwapper::get_num_accesses(cowns[next_cown].first) ? i : next_cown;
-                            }
-                        }
-
-                        break;
-
-                    case SwappingAlgo::LRU:
-                        for (size_t i = 0; i < cowns.size(); ++i)
-                        {
-                            if (cown_flags[cowns[i].first])
-                            {
-                                next_cown = CownSwapper::get_last_access(cowns[i].first) 
-                                            <= CownSwapper::get_last_access(cowns[next_cown].first) ? i : next_cown;
-                            }
-                        }
-
-                        break;
-
-                    case SwappingAlgo::RANDOM:
-                        next_cown = std::rand() % cowns.size();
-                        break;
-
-                    case SwappingAlgo::ROUND_ROBIN:
-                        break;
-
-                    case SwappingAlgo::SECOND_CHANCE:
-                        while (keep_monitoring && CownSwapper::was_accessed(cowns[next_cown++].first))
-                        { 
-                            if (next_cown == cowns.size())
-                                next_cown = 0;
-                        }
-
-                        --next_cown;
-
-                        break;
-                }
+                case SwappingAlgo::LFU:
+                    return index.pick_sampled([](Cown* cown) { return CownSwapper::get_num_accesses(cown); });
 
-                ret = next_cown;
-                if (++next_cown == cowns.size())
-                    next_cown = 0;
-            }
-            while (!cown_flags[cowns[ret].first] && keep_monitoring);
+                case SwappingAlgo::LRU:
+                    return index.pick_sampled([](Cown* cown) { return -(int64_t)CownSwapper::get_access_age(cown); });
 
-            cown_flags[cowns[ret].first] = false;
+                case SwappingAlgo::RANDOM:
+                    return index.pick_random();
 
-            if (!keep_monitoring)
-                return -1;
+                case SwappingAlgo::ROUND_ROBIN:
+                    return index.pick_clock([](Cown*) { return false; });
 
-            return ret;
+                case SwappingAlgo::SECOND_CHANCE:
+                    return index.pick_clock([](Cown* cown) { return CownSwapper::was_accessed(cown); });
+            }
+
+            return {nullptr, 0};
         }
 
         CownMemoryThread(size_t memory_limit_MB, size_t multiplier, SwappingAlgo swapping_algo, bool debug) 
-        : memory_limit_bytes(memory_limit_MB * 1024 * 1024), multiplier(multiplier), debug(debug), swapping_algo(swapping_algo)
+        : memory_limit_bytes(memory_limit_MB * 1024 * 1024), multiplier(multiplier), debug(debug), swapping_algo(swapping_algo),
+          accounting(memory_limit_bytes * 90 / 100, SAMPLE_INTERVAL)
         {
             this->keep_monitoring = true;
 
@@ -154,6 +123,9 @@ namespace verona::cpp
             this->nothing_loop_count = 0;
 #endif
 
+            // Scheduling only pays for recording accesses while there is a thread to use them.
+            CownSwapper::set_access_tracking(true);
+
             if (! debug)
                 monitoring_thread = std::thread(&CownMemoryThread::monitorMemoryUsage, this);
 
@@ -201,12 +173,10 @@ namespace verona::cpp
         void unregister_cowns()
         {
             std::unique_lock<std::mutex> lock(cowns_mutex);
-            while (!cowns.empty())
-            {
-                CownSwapper::unregister_cown(cowns.back().first);
-                cowns.pop_back();
-            }
-            cowns_size_bytes = 0;
+            for (auto cown : cowns)
+                CownSwapper::unregister_cown(cown);
+            cowns.clear();
+            accounting.clear_resident();
         }
 
         /// @brief Removes all cowns without strong references left from the thread so they can be deallocated.
@@ -216,18 +186,19 @@ namespace verona::cpp
             while (!cowns_to_be_freed.empty())
             {
                 auto cown = cowns_to_be_freed.back();
-                cowns_size_bytes -= cown.second;
-                cowns.erase(std::find(cowns.begin(), cowns.end(), cown));
-                CownSwapper::unregister_cown(cowns_to_be_freed.back().first);
+                cowns.erase(cown.first);
+                CownSwapper::unregister_cown(cown.first);
                 cowns_to_be_freed.pop_back();
             }
         }
 
         /// @brief Main function, monitors memory usage and schedules swaps when the memory usage is within 90% of the
-        /// limit.
+        /// limit. Between rounds the thread sleeps until usage crosses that watermark or the next sample is due. While
+        /// usage is over the watermark, it also wakes every access epoch period.
         void monitorMemoryUsage() {
             auto prev_t = std::chrono::system_clock::now();
             auto prev_swap_time = std::chrono::system_clock::now();
+            auto prev_epoch_time = std::chrono::steady_clock::now();
 
             // Prevent the scheduler from terminating while the thread exists
             schedule_lambda([](){ Scheduler::add_external_event_source(); });
@@ -239,18 +210,23 @@ namespace verona::cpp
 
             while (keep_monitoring.load(std::memory_order_relaxed))
             {
-                // Get memory usage
-                uint64_t system_usage_bytes = getMemoryUsage() * 1024;
-                struct mallinfo2 info = mallinfo2();
-                struct malloc_info_v1 malloc_info;
-                get_malloc_info_v1(&malloc_info);
+                // Scheduler threads only read the epoch, so they never read the clock themselves.
+                auto now = std::chrono::steady_clock::now();
+                if (now - prev_epoch_time >= ACCESS_EPOCH_PERIOD)
+                {
+                    CownSwapper::advance_access_epoch();
+                    prev_epoch_time = now;
+                }
 
-                uint64_t memory_usage = cowns_size_bytes + malloc_info.current_memory_usage;
+                accounting.sample(now);
+                uint64_t memory_usage = accounting.get_usage();
+                bool evicting = memory_limit_bytes > 0 && memory_usage > memory_limit_bytes * 90 / 100;
+                bool swapped = false;
                 if (std::chrono::system_clock::now() > prev_t + std::chrono::seconds(1))
                 {
                     
                     if (print_memory)
-                        std::cout << "Memory Usage: " << cowns_size_bytes / 1024 / 1024 << " MB" << std::endl;
+                        std::cout << "Memory Usage: " << accounting.get_resident() / 1024 / 1024 << " MB" << std::endl;
 
                     prev_t = std::chrono::system_clock::now();
                     if (keep_average)
@@ -262,21 +238,22 @@ namespace verona::cpp
 
 
                 yield();             
-                if (memory_limit_bytes > 0 && memory_usage > memory_limit_bytes * 90 / 100)
+                if (evicting)
                 {
+                    // Pick up cowns fetched back into memory since the last round.
+                    index.drain();
+
                     // Limit the amount of swap behaviours that can concurrently exsist.
-                    const size_t SIZE_LIMIT = cowns.size();
                     const size_t SWAP_COUNT_MAX = 1;
 
                     // Get enough cowns to drop memory usage below the memory limit.
                     int64_t mem_to_swap_bytes = (memory_usage - (memory_limit_bytes * multiplier / 100));
-                    while (!cowns.empty() && cowns_to_swap.size() < SIZE_LIMIT && mem_to_swap_bytes > actual_swap_size)
+                    while (mem_to_swap_bytes > actual_swap_size)
                     {
-                        auto cown_i = get_next_cown();
-                        if (cown_i < 0)
+                        auto cown = get_next_cown();
+                        if (cown.first == nullptr)
                             break;
 
-                        auto cown = cowns[cown_i];
                         cowns_to_swap.push_back(cown);
                         actual_swap_size += cown.second;
                     }
@@ -286,19 +263,20 @@ namespace verona::cpp
                     {
                         prev_usage = memory_usage;
                         prev_swap_time = std::chrono::high_resolution_clock::now();
-                        cowns_size_bytes -= actual_swap_size;
+                        accounting.remove_resident(actual_swap_size);
                         swaps_running.fetch_add(1, std::memory_order_acquire);
                         auto cowns_to_be_freed = 
                             ActualCownSwapper::schedule_swap(cowns_to_swap.size(), cowns_to_swap.data(), swaps_running, 
                                                                 [this](cown_pair cown) 
                                                                 {
-                                                                    cown_flags[cown.first] = true;
-                                                                    cowns_size_bytes += cown.second;
+                                                                    accounting.add_resident(cown.second);
+                                                                    index.insert(cown);
                                                                 });
 
                         unregister_cowns(cowns_to_be_freed);
                         actual_swap_size = 0;
                         cowns_to_swap.clear();
+                        swapped = true;
                     }
                 }
 #ifdef USE_SYSTEMATIC_TESTING
@@ -309,10 +287,18 @@ namespace verona::cpp
                     // After memory has reached the limit notify the benchmark that it can begin.
                     cv.notify_all();
 
+#ifdef USE_SYSTEMATIC_TESTING
                 yield();
+#else
+                // While evicting, keep access ages fresh and notice a finished swap promptly. Otherwise nothing
+                // changes until the next sample, or an update crosses the watermark.
+                if (!swapped)
+                    accounting.wait_until(evicting ? now + ACCESS_EPOCH_PERIOD : accounting.next_sample(now));
+#endif
             }
 
             Logging::cout() << "Monitoring thread terminated" << Logging::endl;
+            CownSwapper::set_access_tracking(false);
             unregister_cowns();
 
             schedule_lambda([](){ Scheduler::remove_external_event_source(); });
@@ -346,6 +332,18 @@ namespace verona::cpp
             return getMemoryUsage() / 1024;
         }
 
+        /// @return Bytes of registered cowns that are in memory.
+        static uint64_t get_resident_bytes()
+        {
+            return get_ref().accounting.get_resident();
+        }
+
+        /// @brief Set how often the allocator's memory usage is sampled. The thread must have been created.
+        static void set_sample_interval(std::chrono::milliseconds interval)
+        {
+            get_ref().accounting.set_sample_interval(interval);
+        }
+
         static const std::string algo_to_string(SwappingAlgo algo)
         {
             std::unordered_map<SwappingAlgo, std::string> table =
@@ -403,6 +401,7 @@ namespace verona::cpp
             std::cout << "Stop called" << std::endl;
             ref.running.store(false, std::memory_order_acq_rel);
             ref.keep_monitoring.store(false, std::memory_order_acq_rel);
+            ref.accounting.wake();
 
             if (!ref.debug)
                 ref.monitoring_thread.join();
@@ -428,10 +427,12 @@ namespace verona::cpp
                 if (cown_pair.first == nullptr)
                     return false;
 
-                std::unique_lock<std::mutex> lock(ref.cowns_mutex);
-                ref.cown_flags[cown_pair.first] = true;
-                ref.cowns.push_back(cown_pair);
-                ref.cowns_size_bytes += cown_pair.second;
+                {
+                    std::unique_lock<std::mutex> lock(ref.cowns_mutex);
+                    ref.cowns.insert(cown_pair.first);
+                }
+                ref.index.insert(cown_pair);
+                ref.accounting.add_resident(cown_pair.second);
             }
 
         // In systematic testing, stop monitoring never gets called because it waits until all threads terminate before
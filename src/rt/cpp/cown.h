@@ -59,6 +59,27 @@ namespace verona::cpp
     : std::true_type
     {};
 
+    /// Alternative to `serialize` that avoids copying the value. `gather` appends the contiguous regions of memory
+    /// that make up the value, which must stay valid until the value is deleted. `scatter` allocates a value for a
+    /// record of the given size, and appends the regions its bytes should be read into, in the same order.
+    template<typename TT, class = void>
+    struct has_gather
+    : std::false_type
+    {};
+    template<typename TT>
+    struct has_gather<TT, std::enable_if_t<std::is_same_v<void(T, std::vector<iovec>&), decltype(TT::gather)>>>
+    : std::true_type
+    {};
+
+    template<typename TT, class = void>
+    struct has_scatter
+    : std::false_type
+    {};
+    template<typename TT>
+    struct has_scatter<TT, std::enable_if_t<std::is_same_v<T(size_t, std::vector<iovec>&), decltype(TT::scatter)>>>
+    : std::true_type
+    {};
+
     template<typename TT, class = void>
     struct has_size
     : std::false_type
@@ -86,9 +107,15 @@ namespace verona::cpp
       if constexpr (is_serializable::value)
         delete value;
     }
+    struct is_zero_copy
+    {
+      constexpr static bool value = std::is_pointer_v<T> && has_gather<BaseT>::value &&
+                                    has_scatter<BaseT>::value && has_size<BaseT>::value;
+    };
     struct is_serializable
     {
-      constexpr static bool value = std::is_pointer_v<T> && has_serialize<BaseT>::value && has_size<BaseT>::value;
+      constexpr static bool value = is_zero_copy::value ||
+        (std::is_pointer_v<T> && has_serialize<BaseT>::value && has_size<BaseT>::value);
     };
 
     /// @brief Function responsible to serialising cown for both reading and writing. If the current value is null it 
@@ -97,7 +124,7 @@ namespace verona::cpp
     /// @param archive The archive stream where the cown is read/written from/to.
     void serialize(std::iostream& archive)
     {
-      if constexpr (is_serializable::value)
+      if constexpr (is_serializable::value && has_serialize<BaseT>::value)
       {
         auto new_value = BaseT::serialize(value, archive);
 
@@ -107,6 +134,24 @@ namespace verona::cpp
         value = new_value;         
       }
     }
+
+    /// @brief Detach the value for swapping out. It is deleted once the buffers have been written.
+    void gather(SwapBuffers& buffers)
+    {
+      if constexpr (is_zero_copy::value)
+      {
+        BaseT::gather(value, buffers.iov);
+        buffers.own(value, [](void* v) { delete (T)v; });
+        value = nullptr;
+      }
+    }
+
+    /// @brief Allocate the value for a record of `size` bytes, which is then read directly into the buffers.
+    void scatter(size_t size, SwapBuffers& buffers)
+    {
+      if constexpr (is_zero_copy::value)
+        value = BaseT::scatter(size, buffers.iov);
+    }
   };
 
   /**
@@ -504,6 +549,17 @@ namespace verona::cpp
       return get_ref();
     }
 
+    /**
+     * Give up this cown before the body of the `when` returns, so behaviours
+     * waiting for it can start while the rest of the body runs.  The
+     * acquired_cown must not be used afterwards.  Any other acquired_cown
+     * for the same cown in this `when` is released as well.
+     */
+    void release()
+    {
+      Behaviour::release_early(&origin_cown);
+    }
+
     /**
      * Deleted to prevent accidental copying or
      * moving.  The lifetime is tied to the `when`,
@@ -3,10 +3,12 @@
 #include "cown.h"
 #include "../sched/behaviour.h"
 #include "../sched/cown_swapper.h"
+#include "../sched/swap_io.h"
+#include "../sched/swap_prefetch.h"
+#include "../sched/swap_store.h"
+#include "../sched/swap_tier.h"
 
 #include <verona.h>
-#include <fstream>
-#include <filesystem>
 #include <sstream>
 
 namespace verona::cpp
@@ -21,16 +23,169 @@ namespace verona::cpp
         {
             Logging::cout() << "Fetch Behaviour " << behaviour << " dealloc" << Logging::endl;
             Be* body = behaviour->get_body<Be>();
-            auto work = behaviour->as_work();
+
+            // The cown died while swapped out, so its record will never be read.
+            auto cown = behaviour->get_slots()[0].cown();
+            CompressedTier::get().discard(cown);
+            SwapStore::get().discard(cown);
             
             // Dealloc behaviour
             body->~Be();
-            work->dealloc();
+            behaviour->dealloc();
+        }
+
+        /// @param count Number of cowns being swapped.
+        /// @param cowns Array of cowns to be swapped.
+        /// @param to_be_swapped Atomic variable indicating the number of swap behaviours that can concurrently exist.
+        /// @return The function used by the swap behaviour. Cowns that fit in the compressed tier are kept there.
+        /// The rest are written as one contiguous record with a single vectored write, and the behaviour suspends
+        /// until it has completed, so scheduler threads are not blocked on the disk. Each cown can still be fetched
+        /// on its own.
+        static auto get_swap_lambda(size_t count, Cown** cowns, std::atomic_uint64_t& to_be_swapped)
+        {
+            auto swap_lambda = [=, &to_be_swapped, batch = (SwapIOBatch*)nullptr, sizes = std::vector<size_t>(),
+                                on_disk = size_t(0)]() mutable
+            {
+                if (batch == nullptr)
+                {
+                    batch = new SwapIOBatch(1);
+                    auto& request = batch->requests[0];
+                    request.op = SwapIORequest::Op::Write;
+
+                    // Cowns going to disk are moved to the front of `cowns`, and their records are the only ones
+                    // left in the buffers.
+                    auto& tier = CompressedTier::get();
+                    size_t offset = 0;
+                    sizes.resize(count);
+                    for (size_t i = 0; i < count; ++i)
+                    {
+                        auto first = request.buffers.iov.size();
+                        auto size = CownSwapper::swap_out(cowns[i], request.buffers);
+                        if (tier.is_enabled() && tier.put(cowns[i], request.buffers.copy(offset, size)))
+                        {
+                            request.buffers.iov.resize(first);
+                            continue;
+                        }
+
+                        cowns[on_disk] = cowns[i];
+                        sizes[on_disk++] = size;
+                        offset += size;
+                    }
+
+                    if (on_disk > 0)
+                    {
+                        auto location = SwapStore::get().allocate(cowns, sizes.data(), on_disk);
+                        request.fd = location.fd;
+                        request.offset = location.offset;
+
+                        SwapIO::submit(batch, Behaviour::suspend());
+                        return;
+                    }
+
+                    // Nothing to write, so the values detached from the cowns can be freed straight away.
+                    delete batch;
+                }
+                else
+                {
+                    auto& store = SwapStore::get();
+                    if (CownSwapper::is_readahead())
+                    {
+                        // A cown requested again while being written out already has its fetch queued behind this
+                        // behaviour, so keep its data for the fetch rather than have it read back.
+                        size_t offset = 0;
+                        for (size_t i = 0; i < on_disk; ++i)
+                        {
+                            if (!CownSwapper::is_swapped(cowns[i]))
+                                store.stash(cowns[i], batch->requests[0].buffers.copy(offset, sizes[i]));
+                            offset += sizes[i];
+                        }
+                    }
+
+                    SwapIO::finish(batch);
+
+                    for (size_t i = 0; i < on_disk; ++i)
+                        store.commit(cowns[i]);
+                }
+
+                to_be_swapped.fetch_sub(1);
+                auto& alloc = ThreadAlloc::get();
+                alloc.dealloc(cowns);
+            };
+            
+            return swap_lambda;
+        }
+
+        /// @param cown Cown to be fetched.
+        /// @param register_to_thread The callback function to inform the swapping thread that the cown is back in
+        /// memory.
+        /// @return The function used by the fetch behaviour. It suspends until the cown has been read back in, then
+        /// deserializes it.
+        static auto get_fetch_lambda(cown_pair cown, std::function<void(cown_pair)> register_to_thread)
+        {
+            return [cown, register_to_thread, batch = (SwapIOBatch*)nullptr, location = SwapStore::Location()]() mutable
+            {
+                if (batch == nullptr)
+                {
+                    if (FetchCorrelations::get().is_enabled())
+                        prefetch_correlated(cown.first);
+
+                    std::string stashed;
+                    if (CompressedTier::get().take(cown.first, stashed) ||
+                        SwapStore::get().take_stash(cown.first, stashed))
+                    {
+                        CownSwapper::swap_in_from(cown.first, std::move(stashed));
+                        register_to_thread(cown);
+                        return;
+                    }
+
+                    location = SwapStore::get().lookup(cown.first);
+
+                    batch = new SwapIOBatch(1);
+                    auto& request = batch->requests[0];
+                    request.op = SwapIORequest::Op::Read;
+                    request.fd = location.fd;
+                    request.offset = location.offset;
+                    if (CownSwapper::is_zero_copy(cown.first))
+                        CownSwapper::swap_in(cown.first, location.size, request.buffers);
+                    else
+                        request.buffer.resize(location.size);
+
+                    SwapIO::submit(batch, Behaviour::suspend());
+                    return;
+                }
+
+                auto data = std::move(batch->requests[0].buffer);
+                SwapIO::finish(batch);
+                SwapStore::get().release(cown.first, location);
+
+                // Zero-copy values were read in place.
+                if (!CownSwapper::is_zero_copy(cown.first))
+                    CownSwapper::swap_in(cown.first, std::move(data));
+
+                register_to_thread(cown);
+            };
+        }
+
+        /// @brief Fetch the swapped out cowns last acquired alongside `cown`, by scheduling an empty behaviour on each.
+        static void prefetch_correlated(Cown* cown)
+        {
+            Cown* correlated[FetchCorrelations::WIDTH];
+            auto count = FetchCorrelations::get().take(cown, correlated);
+            for (size_t i = 0; i < count; ++i)
+            {
+                if (CownSwapper::is_swapped(correlated[i]))
+                {
+                    Logging::cout() << "Prefetching cown " << correlated[i] << " with " << cown << Logging::endl;
+                    Behaviour::schedule<YesTransfer>(correlated[i], []() {});
+                }
+                else
+                    Cown::release(ThreadAlloc::get(), correlated[i]);
+            }
         }
 
         static void set_fetch_behaviour(cown_pair cown, std::function<void(cown_pair)> register_to_thread)
         {
-            auto fetch_lambda = CownSwapper::get_fetch_lambda(cown, register_to_thread);
+            auto fetch_lambda = get_fetch_lambda(cown, register_to_thread);
             Request requests[] = {Request::write(cown.first)};
             BehaviourCore *fetch_behaviour = Behaviour::prepare_to_schedule<decltype(fetch_lambda)>
                                             (1, requests, std::forward<decltype(fetch_lambda)>(fetch_lambda));
@@ -64,7 +219,7 @@ namespace verona::cpp
                     cowns_to_be_freed.push_back(cowns[i]);
             }
 
-            auto swap_lambda = CownSwapper::get_swap_lambda(new_size, new_cowns, to_be_swapped);
+            auto swap_lambda = get_swap_lambda(new_size, new_cowns, to_be_swapped);
             Behaviour::schedule<YesTransfer>(new_size, new_cowns, std::forward<decltype(swap_lambda)>(swap_lambda), true);
 
             return cowns_to_be_freed;
@@ -98,6 +253,13 @@ namespace verona::cpp
             return CownSwapper::debug_get_fetches(cown_ptr.allocated_cown);
         }
 
+        /// @return True if the cown is swapped out, and no behaviour has yet requested it be fetched.
+        template<typename T>
+        static bool debug_is_swapped(cown_ptr<T>& cown_ptr)
+        {
+            return CownSwapper::is_swapped(cown_ptr.allocated_cown);
+        }
+
         /// @brief Perform a weak acquire on the cown to prevent it from being freed while the swapping thread holds it.
         /// @return A cown pair if the cown is swappable, otherwise null.
         template<typename T>
@@ -136,21 +298,57 @@ namespace verona::cpp
         }
         
 
+        /// @brief When a cown is requested again before it has been written out, hand its data straight to the
+        /// queued fetch instead of reading it back from disk.
+        static void set_readahead(bool enabled)
+        {
+            CownSwapper::set_readahead(enabled);
+        }
+
+        /// @brief Keep up to `capacity` bytes of swapped out cowns compressed in memory with `codec`, only writing
+        /// cowns to disk once it is full. A capacity of zero disables the tier.
+        static void set_compressed_tier(size_t capacity, std::shared_ptr<SwapCodec> codec = std::make_shared<LzCodec>())
+        {
+            CompressedTier::get().configure(capacity, std::move(codec));
+        }
+
+        /// @brief Whenever a cown is fetched, also fetch the cowns it was last acquired with by a behaviour that
+        /// needed a fetch. Disabling forgets the recorded correlations.
+        static void set_correlation_prefetch(bool enabled)
+        {
+            FetchCorrelations::get().set_enabled(enabled);
+        }
+
         /// @brief Schedule a swap behaviour.
         template<typename T>
         static void schedule_swap(cown_ptr<T>& cown_ptr)
         {
-            ActualCown<T> *cown = get_cown_if_swappable(cown_ptr);
-            if (cown == nullptr)
+            schedule_swap(&cown_ptr, 1);
+        }
+
+        /// @brief Schedule a single swap behaviour for several cowns, which are written out as one record.
+        template<typename T>
+        static void schedule_swap(cown_ptr<T>* cown_ptrs, size_t count)
+        {
+            std::vector<cown_pair> pairs;
+            for (size_t i = 0; i < count; ++i)
             {
-                Logging::cout() << "Cannot swap cown " << cown << " as its value is not serializable" << Logging::endl;
-                return;
+                ActualCown<T> *cown = get_cown_if_swappable(cown_ptrs[i]);
+                if (cown == nullptr)
+                {
+                    Logging::cout() << "Cannot swap cown " << cown << " as its value is not serializable"
+                                    << Logging::endl;
+                    return;
+                }
+
+                pairs.push_back({cown, sizeof_cown(cown)});
             }
 
-            cown_pair pair = {cown, sizeof_cown(cown)};
-            std::atomic_uint64_t to_be_swapped{0};
-            
-            schedule_swap(1, &pair, to_be_swapped, [](cown_pair p){});
+            // The swap behaviour outlives this call, so the counter cannot live on the stack.
+            static std::atomic_uint64_t to_be_swapped{0};
+            to_be_swapped++;
+
+            schedule_swap(pairs.size(), pairs.data(), to_be_swapped, [](cown_pair p){});
         }
     };
 
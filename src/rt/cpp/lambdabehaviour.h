@@ -27,13 +27,20 @@ namespace verona::rt
   }
 
   template<typename T>
-  static void schedule_lambda(T&& f)
+  static void schedule_lambda(
+    T&& f,
+    Priority priority = Priority::Normal,
+    uint64_t deadline = NO_DEADLINE)
   {
     auto w = Closure::make([f = std::forward<T>(f)](Work* w) mutable {
       f();
       return true;
     });
-    Scheduler::schedule(w);
+
+    if (deadline != NO_DEADLINE)
+      Scheduler::schedule_deadline(w, deadline);
+    else
+      Scheduler::schedule(w, priority);
   }
 
   // TODO super minimal version initially, just to get the tests working.
@@ -50,6 +50,15 @@ namespace verona::rt
     constexpr static bool value = T::is_serializable::value;
   };
 
+  template<class T, class = void, class = void>
+  struct has_gatherer : std::false_type
+  {};
+  template<class T>
+  struct has_gatherer<T, std::void_t<decltype(&T::gather)>, std::void_t<decltype(&T::is_zero_copy::value)>>
+  {
+    constexpr static bool value = T::is_zero_copy::value;
+  };
+
   /**
    * Common base class for V and VCown to build descriptors
    * from C++ objects using compile time reflection.
@@ -103,6 +112,29 @@ namespace verona::rt
       }
     }
 
+    static void gc_gather(Object* o, SwapBuffers& buffers)
+    {
+      if constexpr (has_gatherer<T>::value)
+        ((T*)o)->gather(buffers);
+      else
+      {
+        UNUSED(o);
+        UNUSED(buffers);
+      }
+    }
+
+    static void gc_scatter(Object* o, size_t size, SwapBuffers& buffers)
+    {
+      if constexpr (has_gatherer<T>::value)
+        ((T*)o)->scatter(size, buffers);
+      else
+      {
+        UNUSED(o);
+        UNUSED(size);
+        UNUSED(buffers);
+      }
+    }
+
   public:
     VBase() : Base() {}
 
@@ -114,7 +146,9 @@ namespace verona::rt
         has_finaliser<T>::value ? gc_final : nullptr,
         has_notified<T>::value ? gc_notified : nullptr,
         has_destructor<T>::value ? gc_destructor : nullptr,
-        has_serializer<T>::value ? gc_serialize : nullptr};
+        has_serializer<T>::value ? gc_serialize : nullptr,
+        has_gatherer<T>::value ? gc_gather : nullptr,
+        has_gatherer<T>::value ? gc_scatter : nullptr};
 
       return &desc;
     }
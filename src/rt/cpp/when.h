@@ -184,6 +184,8 @@ namespace verona::cpp
           std::move(std::get<0>(t)),
           std::move(std::get<1>(t)),
           std::move(std::get<2>(t)));
+        barray[index]->priority = w.priority;
+        barray[index]->deadline = w.deadline;
         create_behaviour<index + 1>(barray);
       }
     }
@@ -203,6 +205,17 @@ namespace verona::cpp
         BehaviourCore* barray[sizeof...(Args)];
         create_behaviour(barray);
 
+        if constexpr (sizeof...(Args) == 1)
+        {
+          // A lone `when (a)` or `when (a, b)` has its arity fixed by its type.
+          using W = std::tuple_element_t<0, std::tuple<Args...>>;
+          if constexpr (W::fixed_count() == 1 || W::fixed_count() == 2)
+          {
+            BehaviourCore::schedule_fixed<W::fixed_count()>(barray[0]);
+            return;
+          }
+        }
+
         BehaviourCore::schedule_many(barray, sizeof...(Args));
       }
     }
@@ -231,6 +244,9 @@ namespace verona::cpp
     template<class T>
     struct is_read_only<Access<const T>> : std::true_type
     {};
+    template<class T>
+    struct is_read_only<AccessBatch<const T>> : std::true_type
+    {};
 
     template<class T>
     struct is_batch : std::false_type
@@ -248,17 +264,28 @@ namespace verona::cpp
     /// The closure to be executed.
     F f;
 
+    /// Priority to schedule the behaviour at.
+    Priority priority = Priority::Normal;
+
+    /// Deadline to schedule the behaviour by, if any.
+    uint64_t deadline = NO_DEADLINE;
+
+    /// Requests that fit in the When itself, so that small cown spans do
+    /// not need a heap allocation either.
+    static constexpr size_t INLINE_REQUESTS =
+      sizeof...(Args) > 8 ? sizeof...(Args) : 8;
+
     /// Used as a temporary to build the behaviour.
     /// The stack lifetime is tricky, and this avoids
     /// a heap allocation.
-    Request requests[sizeof...(Args)];
+    Request requests[INLINE_REQUESTS];
 
-    // If cown_ptr spans provided more requests are required
-    // and thus are dynamically allocated.
+    // If cown_ptr spans provided more requests than fit in requests[], they
+    // are dynamically allocated.
     // If is_req_extended is true, then req_extended holds an array of Request
     // and the above requests[] array is not used.
-    Request* req_extended;
-    bool is_req_extended;
+    Request* req_extended = nullptr;
+    bool is_req_extended = false;
 
     /**
      * This uses template programming to turn the std::tuple into a C style
@@ -269,7 +296,7 @@ namespace verona::cpp
     template<typename C>
     static void array_assign_helper_access(Request* req, Access<C>& p)
     {
-      if constexpr (is_read_only<decltype(p)>())
+      if constexpr (is_read_only<Access<C>>())
         *req = Request::read(p.t);
       else
         *req = Request::write(p.t);
@@ -287,7 +314,7 @@ namespace verona::cpp
       size_t it_cnt = 0;
       for (size_t i = 0; i < p.arr_len; i++)
       {
-        if constexpr (is_read_only<decltype(p)>())
+        if constexpr (is_read_only<AccessBatch<C>>())
           *req = Request::read(p.act_array[i]);
         else
           *req = Request::write(p.act_array[i]);
@@ -330,6 +357,18 @@ namespace verona::cpp
       }
     }
 
+    /**
+     * The number of cowns requested, if it does not depend on the length of
+     * a `cown_array`, and 0 otherwise.
+     */
+    static constexpr size_t fixed_count()
+    {
+      if constexpr ((is_batch<Args>() || ...))
+        return 0;
+      else
+        return sizeof...(Args);
+    }
+
     template<size_t index = 0>
     size_t get_cown_count(size_t count = 0)
     {
@@ -403,13 +442,19 @@ namespace verona::cpp
   public:
     When(F&& f_) : f(std::forward<F>(f_)) {}
 
-    When(F&& f_, std::tuple<Args...> cown_tuple_)
+    When(
+      F&& f_,
+      std::tuple<Args...> cown_tuple_,
+      Priority priority_,
+      uint64_t deadline_)
     : f(std::forward<F>(f_)),
       cown_tuple(std::move(cown_tuple_)),
+      priority(priority_),
+      deadline(deadline_),
       is_req_extended(false)
     {
       const size_t req_count = get_cown_count();
-      if (req_count > sizeof...(Args))
+      if (req_count > INLINE_REQUESTS)
       {
         is_req_extended = true;
         req_extended = reinterpret_cast<Request*>(
@@ -420,6 +465,8 @@ namespace verona::cpp
     When(When&& o)
     : cown_tuple(std::move(o.cown_tuple)),
       f(std::forward<F>(o.f)),
+      priority(o.priority),
+      deadline(o.deadline),
       is_req_extended(o.is_req_extended),
       req_extended(o.req_extended)
     {
@@ -464,9 +511,40 @@ namespace verona::cpp
      */
     std::tuple<Args...> cown_tuple;
 
+    Priority prio = Priority::Normal;
+
+    uint64_t due = NO_DEADLINE;
+
     PreWhen(Args... args) : cown_tuple(std::move(args)...) {}
 
   public:
+    /**
+     * Set the priority the behaviour is scheduled at once it has acquired its
+     * cowns:
+     *
+     *   when (cown1, ..., cownn).priority(Priority::High) << closure;
+     */
+    PreWhen&& priority(Priority p) &&
+    {
+      prio = p;
+      return std::move(*this);
+    }
+
+    /**
+     * Set a deadline, as an absolute `snmalloc::Aal::tick()` value, for the
+     * behaviour to run by once it has acquired its cowns:
+     *
+     *   when (cown1, ..., cownn).deadline(Aal::tick() + budget) << closure;
+     *
+     * Behaviours with deadlines run at normal priority, earliest deadline
+     * first, see `Scheduler::schedule_deadline`.
+     */
+    PreWhen&& deadline(uint64_t d) &&
+    {
+      due = d;
+      return std::move(*this);
+    }
+
     template<typename F>
     auto operator<<(F&& f)
     {
@@ -475,13 +553,13 @@ namespace verona::cpp
       if constexpr (sizeof...(Args) == 0)
       {
         // Execute now atomic batch makes no sense.
-        verona::rt::schedule_lambda(std::forward<F>(f));
+        verona::rt::schedule_lambda(std::forward<F>(f), prio, due);
         return Batch(std::make_tuple());
       }
       else
       {
-        return Batch(
-          std::make_tuple(When(std::forward<F>(f), std::move(cown_tuple))));
+        return Batch(std::make_tuple(
+          When(std::forward<F>(f), std::move(cown_tuple), prio, due)));
       }
     }
   };
@@ -0,0 +1,208 @@
+// Copyright Microsoft and Project Verona Contributors.
+// SPDX-License-Identifier: MIT
+#pragma once
+
+#include "stackarray.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+
+namespace verona::rt
+{
+  /**
+   * Stable sort of an array by an integer key extracted from each item.
+   *
+   * Each key is extracted once.  How the keys are sorted depends on how many
+   * there are:
+   *  - up to 4, in place by a fixed sorting network;
+   *  - up to `INSERTION_MAX`, in place by insertion sort;
+   *  - up to `RADIX_MIN`, by `std::sort` on the key and original position;
+   *  - otherwise, by a least significant digit radix sort, which skips the
+   *    digits that every key shares, such as the high bits of pointers.
+   * The larger sorts order the keys, and then permute the items into place.
+   */
+  class KeySort
+  {
+    static constexpr size_t INSERTION_MAX = 16;
+    static constexpr size_t RADIX_MIN = 256;
+    static constexpr size_t DIGIT_BITS = 8;
+    static constexpr size_t DIGITS = 1 << DIGIT_BITS;
+
+    struct Keyed
+    {
+      uint64_t key;
+      size_t index;
+
+      bool operator<(const Keyed& other) const
+      {
+        return key != other.key ? key < other.key : index < other.index;
+      }
+    };
+
+    /**
+     * Sorts small arrays in place, keeping the keys alongside.  Only adjacent
+     * items are ever exchanged, and only if they are out of order, so this is
+     * stable.
+     */
+    template<typename T>
+    class Small
+    {
+      T* items;
+      uint64_t* keys;
+
+      void compare_exchange(size_t a)
+      {
+        if (keys[a + 1] < keys[a])
+        {
+          using std::swap;
+          swap(items[a], items[a + 1]);
+          swap(keys[a], keys[a + 1]);
+        }
+      }
+
+    public:
+      Small(T* items, uint64_t* keys) : items(items), keys(keys) {}
+
+      void network(size_t count)
+      {
+        switch (count)
+        {
+          case 2:
+            compare_exchange(0);
+            return;
+
+          case 3:
+            compare_exchange(0);
+            compare_exchange(1);
+            compare_exchange(0);
+            return;
+
+          case 4:
+            compare_exchange(0);
+            compare_exchange(2);
+            compare_exchange(1);
+            compare_exchange(0);
+            compare_exchange(2);
+            compare_exchange(1);
+            return;
+
+          default:
+            return;
+        }
+      }
+
+      void insertion(size_t count)
+      {
+        for (size_t i = 1; i < count; i++)
+        {
+          auto key = keys[i];
+          if (!(key < keys[i - 1]))
+            continue;
+
+          auto item = std::move(items[i]);
+          size_t j = i;
+          for (; j > 0 && key < keys[j - 1]; j--)
+          {
+            items[j] = std::move(items[j - 1]);
+            keys[j] = keys[j - 1];
+          }
+          items[j] = std::move(item);
+          keys[j] = key;
+        }
+      }
+    };
+
+    static void radix(Keyed* k, size_t count)
+    {
+      // Digits where every key is the same need no pass.
+      uint64_t all = ~(uint64_t)0;
+      uint64_t any = 0;
+      for (size_t i = 0; i < count; i++)
+      {
+        all &= k[i].key;
+        any |= k[i].key;
+      }
+      uint64_t varies = all ^ any;
+
+      StackArray<Keyed> buffer(count);
+      Keyed* from = k;
+      Keyed* to = buffer.get();
+      size_t histogram[DIGITS];
+
+      for (size_t shift = 0; shift < 64; shift += DIGIT_BITS)
+      {
+        if (((varies >> shift) & (DIGITS - 1)) == 0)
+          continue;
+
+        std::fill(histogram, histogram + DIGITS, 0);
+        for (size_t i = 0; i < count; i++)
+          histogram[(from[i].key >> shift) & (DIGITS - 1)]++;
+
+        size_t total = 0;
+        for (auto& h : histogram)
+        {
+          auto c = h;
+          h = total;
+          total += c;
+        }
+
+        for (size_t i = 0; i < count; i++)
+          to[histogram[(from[i].key >> shift) & (DIGITS - 1)]++] = from[i];
+
+        std::swap(from, to);
+      }
+
+      if (from != k)
+        std::copy(from, from + count, k);
+    }
+
+  public:
+    /**
+     * Sort `count` items by `key(item)`, keeping items with equal keys in
+     * their current order.
+     */
+    template<typename T, typename Key>
+    static void sort(T* items, size_t count, Key key)
+    {
+      if (count < 2)
+        return;
+
+      if (count <= INSERTION_MAX)
+      {
+        uint64_t keys[INSERTION_MAX];
+        for (size_t i = 0; i < count; i++)
+          keys[i] = (uint64_t)key(items[i]);
+
+        Small<T> small(items, keys);
+        if (count <= 4)
+          small.network(count);
+        else
+          small.insertion(count);
+        return;
+      }
+
+      StackArray<Keyed> keys(count);
+      bool sorted = true;
+      for (size_t i = 0; i < count; i++)
+      {
+        keys[i] = {(uint64_t)key(items[i]), i};
+        if (i > 0 && keys[i].key < keys[i - 1].key)
+          sorted = false;
+      }
+
+      if (sorted)
+        return;
+
+      if (count < RADIX_MIN)
+        std::sort(keys.get(), keys.get() + count);
+      else
+        radix(keys.get(), count);
+
+      StackArray<T> copy(count);
+      std::copy(items, items + count, copy.get());
+      for (size_t i = 0; i < count; i++)
+        items[i] = copy[keys[i].index];
+    }
+  };
+} // namespace verona::rt
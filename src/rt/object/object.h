@@ -67,6 +67,7 @@ namespace verona::rt
   using namespace snmalloc;
   class Object;
   class RegionBase;
+  struct SwapBuffers;
 
   using RefCounts = Bag<Object, uintptr_t, Alloc>;
   using RefCount = RefCounts::Elem;
@@ -104,12 +105,22 @@ namespace verona::rt
 
     using SerializeFunction = void (*)(Object *o, std::iostream& archive);
 
+    // Zero-copy alternative to the serializer. The gatherer detaches the
+    // object's value and describes the memory it occupies, so it can be
+    // written out directly. The scatterer allocates a new value for a record
+    // of the given size and describes where its bytes should be read into.
+    using GatherFunction = void (*)(Object* o, SwapBuffers& buffers);
+
+    using ScatterFunction = void (*)(Object* o, size_t size, SwapBuffers& buffers);
+
     size_t size;
     TraceFunction trace;
     FinalFunction finaliser;
     NotifiedFunction notified = nullptr;
     DestructorFunction destructor = nullptr;
     SerializeFunction serializer = nullptr;
+    GatherFunction gatherer = nullptr;
+    ScatterFunction scatterer = nullptr;
     // TODO: virtual dispatch, pattern matching on type, reflection
   };
 
@@ -830,6 +841,11 @@ namespace verona::rt
       return get_descriptor()->serializer != nullptr;
     }
 
+    inline bool has_gatherer()
+    {
+      return get_descriptor()->gatherer != nullptr;
+    }
+
     static inline bool is_trivial(const Descriptor* desc)
     {
       return desc->destructor == nullptr && desc->finaliser == nullptr;
@@ -878,6 +894,16 @@ namespace verona::rt
         get_descriptor()->serializer(this, archive);
     }
 
+    inline void gather(SwapBuffers& buffers)
+    {
+      get_descriptor()->gatherer(this, buffers);
+    }
+
+    inline void scatter(size_t size, SwapBuffers& buffers)
+    {
+      get_descriptor()->scatterer(this, size, buffers);
+    }
+
     inline void dealloc(Alloc& alloc)
     {
       alloc.dealloc(&this->get_header(), size());
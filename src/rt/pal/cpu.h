@@ -5,9 +5,12 @@
 #include <snmalloc/snmalloc.h>
 
 #if defined(__linux__)
+#  include <ctype.h>
+#  include <dirent.h>
 #  include <sched.h>
 #  include <stdio.h>
 #  include <stdlib.h>
+#  include <string.h>
 #  include <unistd.h>
 #elif defined(_WIN32)
 #  include <processtopologyapi.h>
@@ -37,6 +40,23 @@ namespace verona::rt
   using namespace snmalloc;
   class Topology
   {
+  public:
+    /**
+     * How far apart two CPUs are, from the point of view of sharing caches.
+     * Returned by `distance`.
+     */
+    enum Distance : size_t
+    {
+      /// The same physical core.
+      Sibling,
+      /// Cores sharing a last level cache.
+      Cache,
+      /// Cores on the same NUMA node.
+      Node,
+      Remote,
+      DISTANCES
+    };
+
   private:
     struct CPU
     {
@@ -45,6 +65,10 @@ namespace verona::rt
       size_t group;
       size_t id;
       bool hyperthread;
+      /// Identifies the physical core, and the last level cache. Zero where
+      /// the topology is not detected.
+      size_t core = 0;
+      size_t cache = 0;
 
       size_t get()
       {
@@ -100,12 +124,14 @@ namespace verona::rt
       uint32_t index = 0;
       uint32_t found = 0;
 
-      // TODO: CPU topology detection for Linux
       while (found < count)
       {
         if (CPU_ISSET(index, &all_cpus))
         {
           cpus.push_back(CPU{0, 0, 0, index, false});
+#  if defined(__linux__)
+          read_sysfs_topology(cpus.back());
+#  endif
           found++;
         }
 
@@ -114,6 +140,112 @@ namespace verona::rt
     }
 #endif
 
+#if defined(__linux__)
+    /**
+     * Reads the first number in a sysfs file, such as an id or the first CPU
+     * of a CPU list.
+     */
+    static bool read_sysfs(const char* path, size_t& value)
+    {
+      FILE* file = fopen(path, "r");
+      if (file == nullptr)
+        return false;
+
+      bool found = fscanf(file, "%zu", &value) == 1;
+      fclose(file);
+      return found;
+    }
+
+    /**
+     * Fills in the topology of a CPU from sysfs. Physical cores and caches
+     * are identified by the first CPU that shares them, so the ids are unique
+     * across packages. Anything that cannot be read keeps its default.
+     */
+    static void read_sysfs_topology(CPU& cpu)
+    {
+      const char* base = "/sys/devices/system/cpu/cpu";
+      char path[128];
+      size_t value;
+
+      cpu.core = cpu.id;
+      snprintf(
+        path,
+        sizeof(path),
+        "%s%zu/topology/physical_package_id",
+        base,
+        cpu.id);
+      if (read_sysfs(path, value))
+        cpu.package = value;
+
+      snprintf(
+        path,
+        sizeof(path),
+        "%s%zu/topology/thread_siblings_list",
+        base,
+        cpu.id);
+      if (read_sysfs(path, value))
+      {
+        cpu.core = value;
+        cpu.hyperthread = value != cpu.id;
+      }
+
+      // The last level cache is the cache index with the highest level.
+      size_t last_level = 0;
+      for (size_t index = 0;; index++)
+      {
+        size_t level;
+        snprintf(
+          path,
+          sizeof(path),
+          "%s%zu/cache/index%zu/level",
+          base,
+          cpu.id,
+          index);
+        if (!read_sysfs(path, level))
+          break;
+
+        snprintf(
+          path,
+          sizeof(path),
+          "%s%zu/cache/index%zu/shared_cpu_list",
+          base,
+          cpu.id,
+          index);
+        if (level >= last_level && read_sysfs(path, value))
+        {
+          last_level = level;
+          cpu.cache = value;
+        }
+      }
+
+      // The CPU's directory links to its NUMA node as `node<N>`.
+      snprintf(path, sizeof(path), "%s%zu", base, cpu.id);
+      DIR* dir = opendir(path);
+      if (dir == nullptr)
+        return;
+
+      while (dirent* entry = readdir(dir))
+      {
+        if (strncmp(entry->d_name, "node", 4) == 0 && isdigit(entry->d_name[4]))
+        {
+          cpu.numa_node = strtoul(entry->d_name + 4, nullptr, 10);
+          break;
+        }
+      }
+      closedir(dir);
+    }
+#endif
+
+    CPU* find(size_t cpu)
+    {
+      for (auto& c : cpus)
+      {
+        if (c.get() == cpu)
+          return &c;
+      }
+      return nullptr;
+    }
+
   public:
     static void init(Topology* top) noexcept
     {
@@ -149,12 +281,16 @@ namespace verona::rt
 
             if (idmask & p->Processor.GroupMask[j].Mask)
             {
+              size_t cpu_package =
+                get_package(group, id, package, package_count);
               top->cpus.push_back(CPU{
                 get_numa_node(group, id, numa, numa_count),
-                get_package(group, id, package, package_count),
+                cpu_package,
                 group,
                 id,
-                hyperthread});
+                hyperthread,
+                i,
+                cpu_package});
 
               hyperthread = true;
             }
@@ -220,6 +356,41 @@ namespace verona::rt
       return cpus.size();
     }
 
+    /**
+     * The NUMA node of a CPU, as returned by `get`, or zero if it is not
+     * known.
+     */
+    size_t numa_node(size_t cpu)
+    {
+      CPU* c = find(cpu);
+      return c == nullptr ? 0 : c->numa_node;
+    }
+
+    /**
+     * How far apart two CPUs, as returned by `get`, are. A CPU that is not in
+     * the topology is `Remote` from every other. A CPU whose sysfs topology
+     * could not be read is its own core, in package, cache and NUMA node 0,
+     * so it is at least `Cache` from any other CPU.
+     */
+    Distance distance(size_t a, size_t b)
+    {
+      CPU* x = find(a);
+      CPU* y = find(b);
+      if (x == nullptr || y == nullptr)
+        return Remote;
+
+      if (x->numa_node != y->numa_node)
+        return Remote;
+
+      if (x->package != y->package || x->cache != y->cache)
+        return Node;
+
+      if (x->group != y->group || x->core != y->core)
+        return Cache;
+
+      return Sibling;
+    }
+
   private:
 #ifdef _WIN32
     static PSYSTEM_LOGICAL_PROCESSOR_INFORMATION_EX
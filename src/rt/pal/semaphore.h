@@ -18,7 +18,67 @@
 #  if __has_include(<version>)
 #    include <version>
 #  endif
-#  if defined(__cpp_lib_semaphore)
+#  if defined(__linux__)
+#    include <climits>
+#    include <cstdint>
+#    include <linux/futex.h>
+#    include <sys/syscall.h>
+#    include <unistd.h>
+namespace verona::rt::pal
+{
+  /**
+   * Binary semaphore directly on a futex, so releasing it only makes a system
+   * call if the thread is actually asleep.
+   */
+  class SemaphoreImpl
+  {
+    enum : uint32_t
+    {
+      Empty,
+      Released,
+      Sleeping
+    };
+
+    std::atomic<uint32_t> state{Empty};
+
+    long futex(int op, uint32_t value)
+    {
+      return syscall(
+        SYS_futex,
+        reinterpret_cast<uint32_t*>(&state),
+        op | FUTEX_PRIVATE_FLAG,
+        value,
+        nullptr,
+        nullptr,
+        0);
+    }
+
+  public:
+    void release()
+    {
+      if (state.exchange(Released, std::memory_order_release) == Sleeping)
+        futex(FUTEX_WAKE, 1);
+    }
+
+    void acquire()
+    {
+      while (true)
+      {
+        uint32_t s = Released;
+        if (state.compare_exchange_strong(s, Empty, std::memory_order_acquire))
+          return;
+
+        // Announce we are going to sleep, unless released in the meantime.
+        if (s == Empty && !state.compare_exchange_strong(s, Sleeping))
+          continue;
+
+        // Returns early if already released, or on a signal, so just retry.
+        futex(FUTEX_WAIT, Sleeping);
+      }
+    }
+  };
+} // namespace verona::rt::pal
+#  elif defined(__cpp_lib_semaphore)
 #    include <semaphore>
 namespace verona::rt::pal
 {
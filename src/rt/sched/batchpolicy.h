@@ -0,0 +1,85 @@
+// Copyright Microsoft and Project Verona Contributors.
+// SPDX-License-Identifier: MIT
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <snmalloc/snmalloc.h>
+
+namespace verona::rt
+{
+  /**
+   * How many work items a scheduler thread runs from its own recently
+   * scheduled work before it next looks at its core's queue, and so at work
+   * from other threads and the fairness token.
+   */
+  enum class BatchPolicy
+  {
+    /// Always the configured batch size.
+    Fixed,
+    /// Sized from the measured run time of recent batches, and whether other
+    /// work was waiting at the end of them.
+    Adaptive,
+  };
+
+  /**
+   * Chooses batch sizes for one scheduler thread under `BatchPolicy::Adaptive`.
+   *
+   * Each batch is sized to take roughly a time budget, from the average run
+   * time of the items in the previous batch.  The budget is short while other
+   * work is waiting in the core's queue, so it is not held up behind a long
+   * local chain, and long when nothing is waiting, so chains of short
+   * behaviours on one cown stay local.  Sizes are smoothed, so a single
+   * outlier batch does not swing them.
+   */
+  class BatchSizer
+  {
+  public:
+    static constexpr size_t MIN_BATCH = 4;
+    static constexpr size_t MAX_BATCH = 4096;
+
+  private:
+    /// Budgets for a batch, in ticks.
+    static constexpr uint64_t LATENCY_BUDGET = 100'000;
+    static constexpr uint64_t THROUGHPUT_BUDGET = 2'000'000;
+
+    uint64_t start = 0;
+    size_t size;
+
+  public:
+    BatchSizer(size_t initial) : size(std::clamp(initial, MIN_BATCH, MAX_BATCH))
+    {}
+
+    /**
+     * Start timing a batch.  Also called after a thread has been idle, so the
+     * idle time is not mistaken for run time.
+     */
+    void start_batch()
+    {
+      start = snmalloc::Aal::tick();
+    }
+
+    /**
+     * Size the next batch, given that `ran` items were run in the batch just
+     * finished, and whether other work was `waiting` at its end.
+     */
+    size_t next_batch(size_t ran, bool waiting)
+    {
+      auto now = snmalloc::Aal::tick();
+      auto elapsed = now - start;
+      start = now;
+
+      if (ran != 0)
+      {
+        auto per_item = std::max<uint64_t>(elapsed / ran, 1);
+        auto budget = waiting ? LATENCY_BUDGET : THROUGHPUT_BUDGET;
+        auto target = (size_t)std::clamp<uint64_t>(
+          budget / per_item, MIN_BATCH, MAX_BATCH);
+        size = (size + target) / 2;
+      }
+
+      return size;
+    }
+  };
+} // namespace verona::rt
@@ -18,12 +18,28 @@ namespace verona::rt
       // Dispatch to the body of the behaviour.
       BehaviourCore* behaviour = BehaviourCore::from_work(work);
       Be* body = behaviour->get_body<Be>();
+#ifdef USE_SCHED_STATS
+      auto now = Aal::tick();
+      Scheduler::stats().queueing_delay(
+        now - behaviour->ready_tick, now > behaviour->deadline);
+#endif
+      if (Scheduler::get_affinity())
+        behaviour->set_home_core(Scheduler::local_core());
+      current_work() = work;
       (*body)();
+      current_work() = nullptr;
 
       if (behaviour_rerun())
       {
         behaviour_rerun() = false;
-        Scheduler::schedule(work);
+        behaviour->dispatch();
+        return;
+      }
+
+      if (behaviour_suspended())
+      {
+        // Whoever called `suspend` is responsible for rescheduling.
+        behaviour_suspended() = false;
         return;
       }
 
@@ -31,7 +47,7 @@ namespace verona::rt
 
       // Dealloc behaviour
       body->~Be();
-      work->dealloc();
+      behaviour->dealloc();
     }
 
   public:
@@ -41,6 +57,48 @@ namespace verona::rt
       return rerun;
     }
 
+    static bool& behaviour_suspended()
+    {
+      static thread_local bool suspended = false;
+      return suspended;
+    }
+
+    static Work*& current_work()
+    {
+      static thread_local Work* work = nullptr;
+      return work;
+    }
+
+    /**
+     * Release `cown` from the currently running behaviour before its body
+     * returns, so that behaviours waiting for `cown` can start while the rest
+     * of the body runs.  The body must not access `cown` afterwards.
+     *
+     * Returns false if the behaviour does not hold `cown`.
+     */
+    static bool release_early(Cown* cown)
+    {
+      assert(current_work() != nullptr);
+      return BehaviourCore::from_work(current_work())->release_early(cown);
+    }
+
+    /**
+     * Suspend the currently running behaviour.
+     *
+     * When the body returns, the behaviour keeps all of its cowns, and is
+     * neither released nor deallocated.  The returned work item must later
+     * be passed to `Scheduler::schedule`, which runs the body again.  This can
+     * happen from any thread, and may happen before the current run of the
+     * body has returned, so the body must not touch its state after calling
+     * this.
+     */
+    static Work* suspend()
+    {
+      assert(current_work() != nullptr);
+      behaviour_suspended() = true;
+      return current_work();
+    }
+
     template<typename Be, typename T>
     static Behaviour* make(size_t count, T&& f, bool is_swap = false)
     {
@@ -66,10 +124,9 @@ namespace verona::rt
     template<TransferOwnership transfer = NoTransfer, class T>
     static void schedule(size_t count, Cown** cowns, T&& f, bool is_swap = false)
     {
-      // TODO Remove vector allocation here.  This is a temporary fix to
+      // TODO Remove this copy.  This is a temporary fix to
       // as we transition to using Request through the code base.
-      auto& alloc = ThreadAlloc::get();
-      Request* requests = (Request*)alloc.alloc(count * sizeof(Request));
+      StackArray<Request> requests(count);
 
       for (size_t i = 0; i < count; ++i)
       {
@@ -80,9 +137,7 @@ namespace verona::rt
         }
       }
 
-      schedule<T>(count, requests, std::forward<T>(f), is_swap);
-
-      alloc.dealloc(requests);
+      schedule<T>(count, requests.get(), std::forward<T>(f), is_swap);
     }
 
     /**
@@ -98,7 +153,8 @@ namespace verona::rt
       auto* slots = body->get_slots();
       for (size_t i = 0; i < count; i++)
       {
-        auto* s = new (&slots[i]) Slot(requests[i].cown());
+        auto* s = new (&slots[i])
+          Slot(requests[i].cown(), body, requests[i].is_read());
         if (requests[i].is_move())
           s->set_move();
       }
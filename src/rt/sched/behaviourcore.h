@@ -2,10 +2,12 @@
 // SPDX-License-Identifier: MIT
 #pragma once
 
+#include "../ds/keysort.h"
 #include "../ds/stackarray.h"
 #include "../object/object.h"
 #include "cown.h"
 #include "cown_swapper.h"
+#include "swap_prefetch.h"
 
 #include <snmalloc/snmalloc.h>
 
@@ -60,7 +62,17 @@ namespace verona::rt
 
   struct Slot
   {
-    Cown* cown;
+  private:
+    /**
+     * The cown this slot is waiting on.  The bottom bit is used to mark the
+     * access as read-only.  Duplicate slots within a behaviour have the cown
+     * set to nullptr.
+     */
+    uintptr_t _cown;
+
+    static constexpr uintptr_t READ_ONLY = 0x1;
+
+  public:
     /**
      * Possible values before scheduling to communicate memory management
      * options:
@@ -70,20 +82,66 @@ namespace verona::rt
      * Possible vales after scheduling:
      *   0 - Wait
      *   1 - Ready
-     *   Behaviour* - Next write
+     *   Slot* - Next slot in the queue for this cown
+     *
+     * The READ_AVAILABLE bit can be added to Wait or Ready.  It is set on a
+     * read-only slot that has been woken up while it has no successor, and
+     * means a read-only successor can start immediately without waiting for
+     * this slot to be released.
      *
-     * TODO Read-only When we extend to read-only we will need the following
-     * additional state
-     *   Slot* - Next Read
-     *   2 - Ready and Read available
+     * The NEXT_WRITER bit is set alongside the next slot if that slot needs
+     * write access.  A read-only successor may already be running, or even
+     * finished and deallocated, so the kind of the next slot must be read
+     * from here rather than from the next slot itself.
      */
     std::atomic<uintptr_t> status;
 
-    Slot(Cown* cown) : cown(cown), status(0) {}
+    /// The behaviour this slot belongs to.
+    BehaviourCore* behaviour;
+
+    static constexpr uintptr_t WAIT = 0x0;
+    static constexpr uintptr_t READY = 0x1;
+    static constexpr uintptr_t READ_AVAILABLE = 0x2;
+    static constexpr uintptr_t NEXT_WRITER = 0x4;
+    static constexpr uintptr_t FLAGS = READY | READ_AVAILABLE | NEXT_WRITER;
+
+    Slot(Cown* cown, BehaviourCore* behaviour, bool read_only = false)
+    : _cown((uintptr_t)cown | (read_only ? READ_ONLY : 0)),
+      status(0),
+      behaviour(behaviour)
+    {}
+
+    Cown* cown()
+    {
+      return (Cown*)(_cown & ~READ_ONLY);
+    }
+
+    bool is_read_only()
+    {
+      return (_cown & READ_ONLY) != 0;
+    }
+
+    /**
+     * Used when a duplicate of this slot in the same behaviour requires
+     * write access.
+     */
+    void clear_read_only()
+    {
+      _cown &= ~READ_ONLY;
+    }
+
+    /**
+     * Mark the slot as a duplicate, so it will not take part in the queue.
+     */
+    void clear_cown()
+    {
+      _cown = 0;
+    }
 
     bool is_ready()
     {
-      return status.load(std::memory_order_acquire) == 1;
+      return (status.load(std::memory_order_acquire) & ~READ_AVAILABLE) ==
+        READY;
     }
 
     void set_move()
@@ -98,30 +156,62 @@ namespace verona::rt
 
     void set_ready()
     {
-      status.store(1, std::memory_order_release);
+      // A reader may concurrently be adding READ_AVAILABLE.
+      status.fetch_or(READY, std::memory_order_release);
     }
 
     bool is_wait()
     {
-      return status.load(std::memory_order_relaxed) == 0;
+      return (status.load(std::memory_order_relaxed) & ~READ_AVAILABLE) ==
+        WAIT;
     }
 
-    bool is_behaviour()
+    bool has_next()
     {
-      return status.load(std::memory_order_relaxed) > 1;
+      return (status.load(std::memory_order_relaxed) & ~FLAGS) != 0;
     }
 
-    BehaviourCore* get_behaviour()
+    Slot* get_next()
     {
-      return (BehaviourCore*)status.load(std::memory_order_acquire);
+      return (Slot*)(status.load(std::memory_order_acquire) & ~FLAGS);
     }
 
-    void set_behaviour(BehaviourCore* b)
+    /**
+     * Check if the next slot needs write access.  Must only be called once
+     * the next slot has been linked.
+     */
+    bool is_next_writer()
+    {
+      return (status.load(std::memory_order_acquire) & NEXT_WRITER) != 0;
+    }
+
+    /**
+     * Link the next slot in the queue for this cown.
+     *
+     * Returns true if this slot had already been marked as READ_AVAILABLE.
+     * In that case, if `next` is read-only, the caller is responsible for
+     * waking it up.
+     */
+    bool set_next(Slot* next)
     {
-      status.store((uintptr_t)b, std::memory_order_release);
+      auto v = (uintptr_t)next | (next->is_read_only() ? 0 : NEXT_WRITER);
+      return (status.exchange(v, std::memory_order_acq_rel) &
+              READ_AVAILABLE) != 0;
     }
 
-    void release();
+    BehaviourCore* get_behaviour()
+    {
+      return behaviour;
+    }
+
+    /**
+     * Hand the cown on to the next slot, if any.  `finished` is false if the
+     * behaviour is still running, in which case a successor is never run
+     * straight after it, see `BehaviourCore::resolve_after`.
+     */
+    void release(bool finished = true);
+
+    void wakeup_readers();
 
     void reset()
     {
@@ -129,6 +219,9 @@ namespace verona::rt
     }
   };
 
+  static_assert(
+    alignof(Slot) > Slot::FLAGS, "Slot flags must fit in the alignment bits");
+
   /**
    * @brief This class implements the core logic for the `when` construct in the
    * runtime.
@@ -155,6 +248,16 @@ namespace verona::rt
     std::atomic<size_t> exec_count_down;
     size_t count;
     const bool is_swap_behaviour;
+    /// Priority the behaviour is scheduled at once its cowns are acquired.
+    Priority priority = Priority::Normal;
+    /// Size class the behaviour was allocated in, see `BehaviourPool`.
+    uint8_t size_class = BehaviourPool::UNPOOLED;
+    /// Deadline to run by once its cowns are acquired, or `NO_DEADLINE`.
+    uint64_t deadline = NO_DEADLINE;
+#ifdef USE_SCHED_STATS
+    /// When the behaviour was last handed to the scheduler.
+    uint64_t ready_tick = 0;
+#endif
 
     /**
      * @brief Construct a new Behaviour object
@@ -179,6 +282,15 @@ namespace verona::rt
         this, -static_cast<ptrdiff_t>(sizeof(Work)));
     }
 
+    /**
+     * Deallocate the behaviour, once its body has been destroyed.
+     */
+    void dealloc()
+    {
+      BehaviourPool::dealloc(
+        Scheduler::behaviour_pool(), as_work(), size_class);
+    }
+
     /**
      * @brief Given a pointer to a work object converts it to a
      * BehaviourCore pointer.
@@ -197,15 +309,105 @@ namespace verona::rt
      * Returns true if this call makes the count_down_zero
      */
     void resolve(size_t n = 1)
+    {
+      if (try_resolve(n))
+        dispatch();
+    }
+
+    /**
+     * Remove `n` from the exec_count_down, without dispatching.
+     *
+     * Returns true if the behaviour can now run, in which case the caller is
+     * responsible for running it.
+     */
+    bool try_resolve(size_t n = 1)
     {
       Logging::cout() << "Behaviour::resolve " << n << " for behaviour " << this
                       << Logging::endl;
       // Note that we don't actually perform the last decrement as it is not
       // required.
+      return (exec_count_down.load(std::memory_order_acquire) == n) ||
+        (exec_count_down.fetch_sub(n) == n);
+    }
+
+    /**
+     * Resolve this behaviour for the slot of `prev` on the same cown, which
+     * has finished with it.  If both behaviours only need that cown, then
+     * this one is run straight after `prev` on the same thread, see
+     * `Scheduler::coalesce`, rather than going through the scheduler's
+     * queues.
+     */
+    void resolve_after(BehaviourCore* prev)
+    {
       if (
-        (exec_count_down.load(std::memory_order_acquire) == n) ||
-        (exec_count_down.fetch_sub(n) == n))
-        Scheduler::schedule(as_work());
+        prev == nullptr || prev->count != 1 || count != 1 ||
+        prev->is_swap_behaviour || is_swap_behaviour ||
+        deadline != NO_DEADLINE || priority != prev->priority)
+      {
+        resolve();
+        return;
+      }
+
+      if (!try_resolve())
+        return;
+
+#ifdef USE_SCHED_STATS
+      ready_tick = Aal::tick();
+#endif
+      if (!Scheduler::coalesce(as_work()))
+        dispatch();
+    }
+
+    /**
+     * Hand the behaviour to the scheduler, by its deadline if it has one,
+     * otherwise at its priority.
+     */
+    void dispatch()
+    {
+#ifdef USE_SCHED_STATS
+      ready_tick = Aal::tick();
+#endif
+      if (deadline != NO_DEADLINE)
+        Scheduler::schedule_deadline(as_work(), deadline);
+      else if (Scheduler::get_affinity())
+        Scheduler::schedule_affine(as_work(), priority, home_core());
+      else
+        Scheduler::schedule(as_work(), priority);
+    }
+
+    /**
+     * The core that last ran the first cown of this behaviour, or nullptr if
+     * not known.
+     */
+    Core* home_core()
+    {
+      auto slots = get_slots();
+      for (size_t i = 0; i < count; i++)
+      {
+        auto cown = slots[i].cown();
+        if (cown != nullptr)
+          return cown->home_core.load(std::memory_order_relaxed);
+      }
+      return nullptr;
+    }
+
+    /**
+     * Record `core`, which is running this behaviour, as the home of its
+     * cowns.
+     */
+    void set_home_core(Core* core)
+    {
+      auto slots = get_slots();
+      for (size_t i = 0; i < count; i++)
+      {
+        auto cown = slots[i].cown();
+
+        // Avoid dirtying the cache line if the cown has not moved.
+        if (
+          cown != nullptr &&
+          cown->home_core.load(std::memory_order_relaxed) != core)
+          cown->home_core.store(core, std::memory_order_relaxed);
+      }
     }
 
     // TODO: When C++ 20 move to span.
@@ -237,11 +439,14 @@ namespace verona::rt
       //   | Work | Behaviour | Slot ... Slot | Body |
       size_t size =
         sizeof(Work) + sizeof(BehaviourCore) + (sizeof(Slot) * count) + payload;
-      void* base = ThreadAlloc::get().alloc(size);
+      auto size_class = BehaviourPool::size_class(size);
+      void* base =
+        BehaviourPool::alloc(Scheduler::behaviour_pool(), size, size_class);
 
       Work* work = new (base) Work(f);
       void* base_behaviour = from_work(work);
       BehaviourCore* behaviour = new (base_behaviour) BehaviourCore(count, is_swap);
+      behaviour->size_class = size_class;
 
       // These assertions are basically checking that we won't break any
       // alignment assumptions on Be.  If we add some actual alignment, then
@@ -260,8 +465,8 @@ namespace verona::rt
     }
 
     // Returns if a fetch happened
-    inline static bool check_swap_status(BehaviourCore*& body, Cown*& cown, StackArray<BehaviourCore*>& fetches,
-                                         size_t& first_chain_index, BehaviourCore*& first_body, size_t& transfer_count)
+    inline static bool check_swap_status(BehaviourCore*& body, Cown*& cown, BehaviourCore** fetches,
+                                         size_t& first_chain_index, Slot*& first_slot, size_t& transfer_count)
     {
       if (body->is_swap_behaviour)
       {
@@ -277,8 +482,8 @@ namespace verona::rt
           auto& slot = fetches[first_chain_index]->get_slots()[0];
 
           transfer_count += slot.status;
-          slot.set_behaviour(first_body);
-          first_body = fetches[first_chain_index];
+          slot.set_next(first_slot);
+          first_slot = &slot;
 
           return true;
         }
@@ -287,6 +492,48 @@ namespace verona::rt
       return false;
     }
 
+    /**
+     * Remember the other cowns acquired alongside each cown that had to be
+     * fetched, so they can be prefetched the next time it is fetched.  The
+     * indexes are sorted by cown, so duplicates are adjacent.
+     */
+    static void record_fetch_correlations(
+      std::tuple<size_t, Slot*>* indexes,
+      BehaviourCore** fetches,
+      size_t count)
+    {
+      StackArray<Cown*> cowns(count);
+      size_t distinct = 0;
+      for (size_t i = 0; i < count; i++)
+      {
+        auto cown = std::get<1>(indexes[i])->cown();
+        if (cown != nullptr && (distinct == 0 || cowns[distinct - 1] != cown))
+          cowns[distinct++] = cown;
+      }
+
+      if (distinct < 2)
+        return;
+
+      Cown* others[FetchCorrelations::WIDTH];
+      for (size_t i = 0; i < count; i++)
+      {
+        if (fetches[i] == nullptr)
+          continue;
+
+        auto cown = std::get<1>(indexes[i])->cown();
+        size_t other_count = 0;
+        for (size_t j = 0;
+             j < distinct && other_count < FetchCorrelations::WIDTH;
+             j++)
+        {
+          if (cowns[j] != cown)
+            others[other_count++] = cowns[j];
+        }
+
+        FetchCorrelations::get().record(cown, others, other_count);
+      }
+    }
+
     /**
      * @brief Schedule a behaviour for execution.
      *
@@ -387,13 +634,47 @@ namespace verona::rt
      *
      * (0,a) |-> (1, a (0)) |-> (2, a)
      *
-     * and mark (a (1)) as not having a successor.
+     * and mark (a (1)) as not having a successor.  If either duplicate
+     * requires write access, then the remaining slot requires write access.
+     *
+     * *** Read-only access ***
+     *
+     * Read-only slots are handled in the style of the fair reader-writer
+     * variant of the MCS Queue Lock:
+     *
+     *   J. M. Mellor-Crummey and M. L. Scott. Scalable reader-writer
+     *   synchronization for shared-memory multiprocessors. PPoPP 1991
+     *
+     * When a read-only slot becomes runnable, `wakeup_readers` also wakes any
+     * read-only successors that are already linked, and marks the last reader
+     * READ_AVAILABLE so that readers linked later start immediately.  Each
+     * running reader is counted in the cown's `read_ref_count`, and holds its
+     * own RC on the cown.  A writer queued behind readers is recorded as the
+     * cown's `next_writer`, and is resolved by the last reader to finish.
      */
     static void schedule_many(BehaviourCore** bodies, size_t body_count)
     {
       Logging::cout() << "BehaviourCore::schedule_many" << body_count
                       << Logging::endl;
 
+      if (body_count == 1)
+      {
+        // Most behaviours are scheduled alone on one or two cowns.
+        switch (bodies[0]->count)
+        {
+          case 1:
+            schedule_fixed<1>(bodies[0]);
+            return;
+
+          case 2:
+            schedule_fixed<2>(bodies[0]);
+            return;
+
+          default:
+            break;
+        }
+      }
+
       size_t count = 0;
       for (size_t i = 0; i < body_count; i++)
         count += bodies[i]->count;
@@ -434,30 +715,95 @@ namespace verona::rt
       // We sort first by cown, and then by behaviour number.
       // These means overlaps will be in a sequence in the array in the correct
       // order with respect to the order of the group of behaviours.
-      auto compare = [](
-                       const std::tuple<size_t, Slot*> i,
-                       const std::tuple<size_t, Slot*> j) {
+      // The array is built in behaviour order, so a stable sort by cown alone
+      // gives this.
+      KeySort::sort(indexes.get(), count, acquire_order);
+
+      schedule_sorted(
+        bodies,
+        body_count,
+        indexes.get(),
+        fetches.get(),
+        fetch_ec.get(),
+        ec.get(),
+        count);
+    }
+
+    /**
+     * Schedule a single behaviour on `N` cowns, where `N` is known at compile
+     * time.  This is `schedule_many` for the common `when (a)` and
+     * `when (a, b)`, with the requests ordered without sorting and the
+     * working arrays fixed in size.
+     */
+    template<size_t N>
+    static void schedule_fixed(BehaviourCore* body)
+    {
+      static_assert(N == 1 || N == 2, "Only one or two cowns are specialised");
+      assert(body->count == N);
+
+      Logging::cout() << "BehaviourCore::schedule_fixed " << N
+                      << Logging::endl;
+
+      size_t ec = 1;
+      size_t fetch_ec[N];
+      BehaviourCore* fetches[N];
+      std::tuple<size_t, Slot*> indexes[N];
+      auto slots = body->get_slots();
+      for (size_t i = 0; i < N; i++)
+      {
+        fetch_ec[i] = 1;
+        fetches[i] = nullptr;
+        indexes[i] = {0, &slots[i]};
+      }
+
+      if constexpr (N == 2)
+      {
+        if (acquire_order(indexes[1]) < acquire_order(indexes[0]))
+          std::swap(indexes[0], indexes[1]);
+      }
+
+      schedule_sorted(&body, 1, indexes, fetches, fetch_ec, &ec, N);
+    }
+
+  private:
+    /**
+     * The key that requests are acquired in order of.
+     */
+    static uint64_t acquire_order(const std::tuple<size_t, Slot*>& index)
+    {
 #ifdef USE_SYSTEMATIC_TESTING
-        return std::get<1>(i)->cown->id() == std::get<1>(j)->cown->id() ?
-          std::get<0>(i) < std::get<0>(j) :
-          std::get<1>(i)->cown->id() < std::get<1>(j)->cown->id();
+      return (uint64_t)std::get<1>(index)->cown()->id();
 #else
-        return std::get<1>(i)->cown == std::get<1>(j)->cown ?
-          std::get<0>(i) < std::get<0>(j) :
-          std::get<1>(i)->cown < std::get<1>(j)->cown;
+      return (uint64_t)std::get<1>(index)->cown();
 #endif
-      };
-      if (count > 1)
-        std::sort(indexes.get(), indexes.get() + count, compare);
+    }
+
+    /**
+     * The two phases of `schedule_many`, once the requests are in acquire
+     * order.  Inlined, so that `schedule_fixed` is specialised for its
+     * constant `count`.
+     */
+    ALWAYSINLINE static void schedule_sorted(
+      BehaviourCore** bodies,
+      size_t body_count,
+      std::tuple<size_t, Slot*>* indexes,
+      BehaviourCore** fetches,
+      size_t* fetch_ec,
+      size_t* ec,
+      size_t count)
+    {
+      // Set if any cown had to be fetched.
+      bool fetched = false;
 
       // First phase - Acquire phase.
       size_t i = 0;
       while (i < count)
       {
-        auto cown = std::get<1>(indexes[i])->cown;
+        auto cown = std::get<1>(indexes[i])->cown();
         auto body = bodies[std::get<0>(indexes[i])];
         auto last_slot = std::get<1>(indexes[i]);
-        auto first_body = body;
+        auto first_slot = last_slot;
+        Slot* prev_slot = nullptr;
         size_t first_chain_index = i;
 
         // The number of RCs provided for the current cown by the when.
@@ -468,7 +814,7 @@ namespace verona::rt
         // This is required in two cases:
         //  * overlaps with multiple behaviours; and
         //  * overlaps within a single behaviour.
-        while (((++i) < count) && (cown == std::get<1>(indexes[i])->cown))
+        while (((++i) < count) && (cown == std::get<1>(indexes[i])->cown()))
         {
           // Check if the caller passed an RC and add to the total.
           transfer_count += std::get<1>(indexes[i])->status;
@@ -484,14 +830,26 @@ namespace verona::rt
             // for ourselves.
             ec[std::get<0>(indexes[i])]++;
 
+            // If the duplicate needs write access, then so does the slot we
+            // keep.  Link it again so its predecessor records the change.
+            if (
+              !std::get<1>(indexes[i])->is_read_only() &&
+              last_slot->is_read_only())
+            {
+              last_slot->clear_read_only();
+              if (prev_slot != nullptr)
+                prev_slot->set_next(last_slot);
+            }
+
             // We need to mark the slot as not having a cown associated to it.
-            std::get<1>(indexes[i])->cown = nullptr;
+            std::get<1>(indexes[i])->clear_cown();
             continue;
           }
           body = body_next;
 
           // Extend the chain of behaviours linking on this behaviour
-          last_slot->set_behaviour(body);
+          last_slot->set_next(std::get<1>(indexes[i]));
+          prev_slot = last_slot;
           last_slot = std::get<1>(indexes[i]);
         }
 
@@ -510,10 +868,29 @@ namespace verona::rt
 
           yield();
 
-          if (check_swap_status(body, cown, fetches, first_chain_index, first_body, transfer_count))
+          if (check_swap_status(body, cown, fetches, first_chain_index, first_slot, transfer_count))
+          {
+            // A swapped out cown has no running readers.
             fetch_ec[first_chain_index]++;
+            fetched = true;
+          }
+          else if (first_slot->is_read_only())
+          {
+            // Readers from a previous chain may still be running, but that
+            // does not stop this chain's readers starting.
+            first_slot->wakeup_readers();
+          }
           else
-            ec[std::get<0>(indexes[first_chain_index])]++;
+          {
+            // Readers from a previous chain may still be running.  If so, the
+            // last of them to finish will resolve this behaviour.
+            cown->next_writer = first_slot->get_behaviour();
+            if (cown->read_ref_count.try_write())
+            {
+              cown->next_writer = nullptr;
+              ec[std::get<0>(indexes[first_chain_index])]++;
+            }
+          }
 
           yield();
 
@@ -547,7 +924,7 @@ namespace verona::rt
           Systematic::yield_until([prev]() { return !prev->is_wait(); });
         }
 
-        check_swap_status(body, cown, fetches, first_chain_index, first_body, transfer_count);
+        fetched |= check_swap_status(body, cown, fetches, first_chain_index, first_slot, transfer_count);
 
         Logging::cout() << "Releasing transferred count " << transfer_count
                         << Logging::endl;
@@ -556,10 +933,17 @@ namespace verona::rt
           Cown::release(ThreadAlloc::get(), cown);
 
         yield();
-        prev->set_behaviour(first_body);
+        // If prev is a running reader, then a read-only successor can start
+        // straight away.
+        if (prev->set_next(first_slot) && first_slot->is_read_only())
+          first_slot->wakeup_readers();
         yield();
       }
 
+      // The behaviours are not yet resolved, so all the cowns are still alive.
+      if (fetched && FetchCorrelations::get().is_enabled())
+        record_fetch_correlations(indexes, fetches, count);
+
       // Second phase - Release phase.
       for (size_t i = 0; i < body_count; i++)
       {
@@ -591,6 +975,7 @@ namespace verona::rt
       }
     }
 
+  public:
     /**
      * @brief Release all slots in the behaviour.
      *
@@ -606,6 +991,29 @@ namespace verona::rt
       }
     }
 
+    /**
+     * Release `cown` while the behaviour is still running, so that its
+     * successors on that cown can start.  Returns false if the behaviour
+     * does not hold `cown`, for instance as it has already released it.
+     */
+    bool release_early(Cown* cown)
+    {
+      auto slots = get_slots();
+      for (size_t i = 0; i < count; i++)
+      {
+        if (slots[i].cown() != cown)
+          continue;
+
+        Logging::cout() << "Early release of cown " << cown << " by behaviour "
+                        << this << Logging::endl;
+        slots[i].release(false);
+        // Skipped by `release_all`, as for a duplicate.
+        slots[i].clear_cown();
+        return true;
+      }
+      return false;
+    }
+
     /**
      * Reset the behaviour to look like it has never been scheduled.
      */
@@ -621,43 +1029,137 @@ namespace verona::rt
     }
   };
 
-  inline void Slot::release()
+  inline void Slot::wakeup_readers()
+  {
+    Slot* curr = this;
+    while (true)
+    {
+      assert(curr->is_read_only());
+      auto c = curr->cown();
+
+      Logging::cout() << "Waking reader " << curr->behaviour << " on cown "
+                      << c << Logging::endl;
+
+      // Each running reader holds an RC, so the chain can be completed by a
+      // later reader while this one is still running.
+      c->read_ref_count.add_read();
+      Shared::acquire(c);
+
+      // Either find the next reader, or mark this slot as READ_AVAILABLE so
+      // a reader linked later can start immediately.
+      Slot* next = nullptr;
+      auto v = curr->status.load(std::memory_order_acquire);
+      while (true)
+      {
+        if ((v & ~FLAGS) != 0)
+        {
+          if ((v & NEXT_WRITER) == 0)
+            next = (Slot*)(v & ~FLAGS);
+          break;
+        }
+
+        if (curr->status.compare_exchange_weak(
+              v, v | READ_AVAILABLE, std::memory_order_acq_rel))
+          break;
+      }
+
+      // Once resolved, curr may run and be deallocated, so do not access it
+      // after this.
+      yield();
+      curr->behaviour->resolve();
+
+      if (next == nullptr)
+        return;
+
+      curr = next;
+    }
+  }
+
+  inline void Slot::release(bool finished)
   {
     assert(!is_wait());
 
     // This slot represents a duplicate cown, so we can ignore releasing it.
-    if (cown == nullptr)
+    if (cown() == nullptr)
       return;
 
+    auto c = cown();
+    bool last = false;
+
     if (is_ready())
     {
       yield();
       auto slot_addr = this;
       // Attempt to CAS cown to null.
-      if (cown->last_slot.compare_exchange_strong(
+      if (c->last_slot.compare_exchange_strong(
             slot_addr, nullptr, std::memory_order_acq_rel))
       {
         yield();
-        Logging::cout() << "No more work for cown " << cown << Logging::endl;
+        Logging::cout() << "No more work for cown " << c << Logging::endl;
+        last = true;
+      }
+      else
+      {
+        yield();
+
+        // If we failed, then the another thread is extending the chain
+        while (is_ready())
+        {
+          Systematic::yield_until([this]() { return !is_ready(); });
+          Aal::pause();
+        }
+      }
+    }
+
+    if (!is_read_only())
+    {
+      if (last)
+      {
         // Success, no successor, release scheduler threads reference count.
-        shared::release(ThreadAlloc::get(), cown);
+        shared::release(ThreadAlloc::get(), c);
         return;
       }
 
+      assert(has_next());
+      // Wake up the next behaviour.
+      yield();
+      auto next = get_next();
+      if (!is_next_writer())
+        next->wakeup_readers();
+      else if (finished)
+        next->get_behaviour()->resolve_after(behaviour);
+      else
+        next->get_behaviour()->resolve();
       yield();
+      return;
+    }
 
-      // If we failed, then the another thread is extending the chain
-      while (is_ready())
-      {
-        Systematic::yield_until([this]() { return !is_ready(); });
-        Aal::pause();
-      }
+    // A read-only successor was woken up when it was linked, and may since
+    // have finished and been deallocated, so it must not be accessed.  A
+    // writer must wait for every running reader to finish.
+    if (!last && is_next_writer())
+    {
+      c->next_writer = get_next()->get_behaviour();
+      // We are still counted as a reader, so this cannot succeed.
+      bool acquired = c->read_ref_count.try_write();
+      UNUSED(acquired);
+      assert(!acquired);
     }
 
-    assert(is_behaviour());
-    // Wake up the next behaviour.
     yield();
-    get_behaviour()->resolve();
+    if (c->read_ref_count.release_read())
+    {
+      // Last reader out wakes the waiting writer.
+      auto w = c->next_writer;
+      c->next_writer = nullptr;
+      Logging::cout() << "Last reader on cown " << c << " waking writer " << w
+                      << Logging::endl;
+      w->resolve();
+    }
+
     yield();
+    if (last)
+      shared::release(ThreadAlloc::get(), c);
+    shared::release(ThreadAlloc::get(), c);
   }
 } // namespace verona::rt
@@ -0,0 +1,222 @@
+// Copyright Microsoft and Project Verona Contributors.
+// SPDX-License-Identifier: MIT
+#pragma once
+
+#include "work.h"
+
+#include <snmalloc/snmalloc.h>
+
+namespace verona::rt
+{
+  /**
+   * Caches the memory of small behaviours on each scheduler thread, so
+   * creating and finishing a behaviour does not go to the allocator.
+   *
+   * Behaviours are allocated in size classes of `CLASS_BYTES`.  A finished
+   * behaviour's memory goes onto the free list of its size class on the
+   * thread that ran it, which is often not the thread that created it.  So
+   * threads that mostly run behaviours would build up memory that threads
+   * that mostly create them need.  Once a free list holds `2 * BATCH` blocks,
+   * the oldest `BATCH` are moved, with one lock acquisition, to a depot shared
+   * by all threads.  A thread whose free list is empty takes a whole batch
+   * from the depot, before falling back to the allocator.
+   *
+   * Every block is an allocation of its class size, so it can always be
+   * handed back to the allocator, for instance when off the scheduler threads
+   * or when the depot is full.
+   */
+  class BehaviourPool
+  {
+  public:
+    /// Size class of behaviours that are too large to pool.
+    static constexpr uint8_t UNPOOLED = 0xff;
+
+  private:
+    /// Granularity of the size classes.
+    static constexpr size_t CLASS_BYTES = 64;
+    /// Number of size classes, so the largest pooled behaviour is 512 bytes.
+    static constexpr size_t CLASSES = 8;
+    /// Blocks moved between a thread and the depot at a time.
+    static constexpr size_t BATCH = 32;
+    /// Most batches of a size class kept in the depot.
+    static constexpr size_t DEPOT_BATCHES = 64;
+
+    /// A free block.  The first block of a batch in the depot links to the
+    /// next batch.
+    struct Block
+    {
+      Block* next;
+      Block* next_batch;
+    };
+
+    static_assert(sizeof(Block) <= CLASS_BYTES);
+
+    struct Depot
+    {
+      snmalloc::FlagWord lock;
+      Block* batches[CLASSES] = {};
+      size_t count[CLASSES] = {};
+    };
+
+    static Depot& depot()
+    {
+      SNMALLOC_REQUIRE_CONSTINIT static Depot global_depot;
+      return global_depot;
+    }
+
+    Block* free[CLASSES] = {};
+    size_t length[CLASSES] = {};
+
+    static size_t class_size(uint8_t size_class)
+    {
+      return (size_class + 1) * CLASS_BYTES;
+    }
+
+    static void dealloc_list(Block* b)
+    {
+      auto& alloc = ThreadAlloc::get();
+      while (b != nullptr)
+      {
+        auto next = b->next;
+        alloc.dealloc(b);
+        b = next;
+      }
+    }
+
+    /**
+     * Move the oldest `BATCH` blocks of a full free list to the depot.
+     */
+    void return_batch(uint8_t size_class)
+    {
+      // Keep the most recently freed blocks, as they are most likely cached.
+      Block* last = free[size_class];
+      for (size_t i = 1; i < BATCH; i++)
+        last = last->next;
+
+      Block* batch = last->next;
+      last->next = nullptr;
+      length[size_class] = BATCH;
+
+      auto& d = depot();
+      {
+        FlagLock f(d.lock);
+        if (d.count[size_class] < DEPOT_BATCHES)
+        {
+          batch->next_batch = d.batches[size_class];
+          d.batches[size_class] = batch;
+          d.count[size_class]++;
+          return;
+        }
+      }
+
+      dealloc_list(batch);
+    }
+
+    /**
+     * Refill an empty free list with a batch from the depot.
+     */
+    bool take_batch(uint8_t size_class)
+    {
+      auto& d = depot();
+      FlagLock f(d.lock);
+      auto batch = d.batches[size_class];
+      if (batch == nullptr)
+        return false;
+
+      d.batches[size_class] = batch->next_batch;
+      d.count[size_class]--;
+      free[size_class] = batch;
+      length[size_class] = BATCH;
+      return true;
+    }
+
+  public:
+    constexpr BehaviourPool() = default;
+
+    /**
+     * The size class of a behaviour of `size` bytes, or `UNPOOLED`.
+     */
+    static uint8_t size_class(size_t size)
+    {
+      auto size_class = (size - 1) / CLASS_BYTES;
+      return size_class < CLASSES ? (uint8_t)size_class : UNPOOLED;
+    }
+
+    /**
+     * Allocate a behaviour of `size` bytes in `size_class`, from `pool` if it
+     * is not null.
+     */
+    static void* alloc(BehaviourPool* pool, size_t size, uint8_t size_class)
+    {
+      if (size_class == UNPOOLED)
+        return ThreadAlloc::get().alloc(size);
+
+      if (
+        pool != nullptr &&
+        (pool->free[size_class] != nullptr || pool->take_batch(size_class)))
+      {
+        auto b = pool->free[size_class];
+        pool->free[size_class] = b->next;
+        pool->length[size_class]--;
+        return b;
+      }
+
+      return ThreadAlloc::get().alloc(class_size(size_class));
+    }
+
+    /**
+     * Deallocate the behaviour starting with `work`, in `size_class`, to
+     * `pool` if it is not null.  Memory that the scheduler's queues may still
+     * refer to is deallocated by `Work::dealloc`, which waits for the epoch to
+     * move on, rather than being reused straight away.
+     */
+    static void dealloc(BehaviourPool* pool, Work* work, uint8_t size_class)
+    {
+      if (pool == nullptr || size_class == UNPOOLED || !work->is_reusable())
+      {
+        work->dealloc();
+        return;
+      }
+
+      if (pool->length[size_class] == 2 * BATCH)
+        pool->return_batch(size_class);
+
+      auto b = reinterpret_cast<Block*>(work);
+      b->next = pool->free[size_class];
+      pool->free[size_class] = b;
+      pool->length[size_class]++;
+    }
+
+    /**
+     * Return this thread's blocks to the allocator.
+     */
+    void flush()
+    {
+      for (size_t i = 0; i < CLASSES; i++)
+      {
+        dealloc_list(free[i]);
+        free[i] = nullptr;
+        length[i] = 0;
+      }
+    }
+
+    /**
+     * Return the depot's blocks to the allocator, once no thread is using
+     * it.
+     */
+    static void flush_depot()
+    {
+      auto& d = depot();
+      for (size_t i = 0; i < CLASSES; i++)
+      {
+        while (d.batches[i] != nullptr)
+        {
+          auto batch = d.batches[i];
+          d.batches[i] = batch->next_batch;
+          dealloc_list(batch);
+        }
+        d.count[i] = 0;
+      }
+    }
+  };
+} // namespace verona::rt
@@ -2,23 +2,79 @@
 // SPDX-License-Identifier: MIT
 #pragma once
 
+#include "deadlinequeue.h"
 #include "mpmcq.h"
 #include "schedulerstats.h"
 #include "work.h"
+#include "workdeque.h"
 
 #include <atomic>
 #include <snmalloc/snmalloc.h>
+#include <vector>
 
 namespace verona::rt
 {
   class Core
   {
   public:
+    /**
+     * Another core to steal from, and how far away it is, as a
+     * `Topology::Distance`.
+     */
+    struct Victim
+    {
+      Core* core;
+      size_t distance;
+    };
+
     size_t affinity = 0;
+    /// Queue for `Priority::Normal` work.
     MPMCQ<Work> q;
+    /// Queues for `Priority::High` and `Priority::Low` work.
+    MPMCQ<Work> high_q;
+    MPMCQ<Work> low_q;
+    /// Normal priority work with a deadline, earliest first.
+    DeadlineQueue<> deadlines;
+
+    /**
+     * Set when the token of the next higher priority queue comes round, to
+     * give this priority the next turn.
+     */
+    std::atomic<bool> normal_turn{false};
+    std::atomic<bool> low_turn{false};
+
+    /**
+     * The private deque of the thread servicing this core, so other cores can
+     * steal from it.  Null if no thread has registered one.
+     */
+    std::atomic<WorkDeque<Work>*> local_work{nullptr};
     std::atomic<Core*> next{nullptr};
+
+    /**
+     * Every other core, nearest first, so stealing keeps work within a shared
+     * cache where it can. Cores at the same distance are in ring order.
+     */
+    std::vector<Victim> victims;
     std::atomic<bool> should_steal_for_fairness{false};
 
+    /**
+     * Approximately how much work has been routed to this core by cown
+     * affinity that it has not yet caught up with.  Reduced as the threads
+     * servicing this core take work from its queues.
+     */
+    std::atomic<size_t> affinity_backlog{0};
+
+    /**
+     * Set while the pool has shrunk below this core, see
+     * `Scheduler::set_active_cores`.  Its thread parks, and new work from
+     * other threads is not sent here, but other cores still steal its work.
+     */
+    std::atomic<bool> retired{false};
+
+    /// Index of the group of cores whose threads pause and are woken
+    /// together, see `CorePool::init_pause_groups`.
+    size_t pause_group = 0;
+
     /// Progress and synchronization between the threads.
     //  These counters represent progress on a CPU core, not necessarily on
     //  the core's queue. This is necessary to take into account core-stealing
@@ -37,14 +93,58 @@ namespace verona::rt
     {
       auto w = Closure::make([home](Work* w) {
         home->should_steal_for_fairness = true;
+        home->low_turn = true;
         home->q.enqueue(w);
         return false;
       });
       return w;
     }
 
+    /**
+     * @brief Create the token for the high or low priority queue of `home`.
+     * Once completed it reschedules itself on the same queue.  The high
+     * priority token gives normal priority work a turn.
+     */
+    Work* create_priority_token(Core* home, Priority priority)
+    {
+      auto w = Closure::make([home, priority](Work* w) {
+        if (priority == Priority::High)
+          home->normal_turn = true;
+        home->queue(priority).enqueue(w);
+        return false;
+      });
+      return w;
+    }
+
   public:
-    Core() : q{create_token_work(this)} {}
+    Core()
+    : q{create_token_work(this)},
+      high_q{create_priority_token(this, Priority::High)},
+      low_q{create_priority_token(this, Priority::Low)}
+    {}
+
+    MPMCQ<Work>& queue(Priority priority)
+    {
+      switch (priority)
+      {
+        case Priority::High:
+          return high_q;
+        case Priority::Low:
+          return low_q;
+        default:
+          return q;
+      }
+    }
+
+    /**
+     * Returns true if nothing older than this call is in any of the queues.
+     * See `MPMCQ::nothing_old`.
+     */
+    bool nothing_old()
+    {
+      return q.nothing_old() && high_q.nothing_old() && low_q.nothing_old() &&
+        deadlines.empty();
+    }
 
     ~Core() {}
   };
@@ -5,6 +5,8 @@
 #include "core.h"
 #include "pal/threading.h"
 
+#include <algorithm>
+
 #ifdef USE_SYSTEM_MONITOR
 #  include "sysmonitor.h"
 #endif
@@ -24,11 +26,12 @@ namespace verona::rt
     inline static Singleton<Topology, &Topology::init> topology;
     Core* first_core = nullptr;
     size_t core_count = 0;
+    size_t pause_group_count = 0;
 
   public:
     constexpr CorePool() = default;
 
-    void init(size_t count)
+    void init(size_t count, size_t group_cores, size_t max_groups)
     {
       core_count = count;
       // TODO mjp: review allocation.
@@ -50,6 +53,83 @@ namespace verona::rt
           break;
         }
       }
+
+      init_victims();
+      pause_group_count = init_pause_groups(group_cores, max_groups);
+    }
+
+    /**
+     * Lists the other cores for each core to steal from, nearest first.
+     */
+    void init_victims()
+    {
+      auto& top = topology.get();
+      Core* core = first_core;
+      do
+      {
+        core->victims.clear();
+        for (Core* c = core->next; c != core; c = c->next)
+        {
+          core->victims.push_back(
+            {c, top.distance(core->affinity, c->affinity)});
+        }
+
+        std::stable_sort(
+          core->victims.begin(),
+          core->victims.end(),
+          [](const Core::Victim& a, const Core::Victim& b) {
+            return a.distance < b.distance;
+          });
+
+        core = core->next;
+      } while (core != first_core);
+    }
+
+    /**
+     * Splits the cores into groups whose threads pause and are woken
+     * separately.  There is a group per NUMA node, split so that no group has
+     * more than `group_cores` cores.  Once there are `max_groups`, the
+     * remaining cores join the last group.
+     * @return the number of groups.
+     */
+    size_t init_pause_groups(size_t group_cores, size_t max_groups)
+    {
+      /// The group being filled for a NUMA node.
+      struct Filling
+      {
+        size_t node;
+        size_t group;
+        size_t cores;
+      };
+
+      auto& top = topology.get();
+      std::vector<Filling> filling;
+      size_t count = 0;
+      Core* core = first_core;
+      do
+      {
+        auto node = top.numa_node(core->affinity);
+        auto f = std::find_if(filling.begin(), filling.end(), [node](auto& f) {
+          return f.node == node;
+        });
+        if (f == filling.end())
+        {
+          filling.push_back({node, count == 0 ? 0 : count - 1, group_cores});
+          f = filling.end() - 1;
+        }
+
+        if (f->cores >= group_cores && count < max_groups)
+        {
+          f->group = count++;
+          f->cores = 0;
+        }
+
+        core->pause_group = f->group;
+        f->cores++;
+        core = core->next;
+      } while (core != first_core);
+
+      return count;
     }
 
     void clear()
@@ -70,6 +150,7 @@ namespace verona::rt
       first_core = nullptr;
       assert(count == core_count);
       core_count = 0;
+      pause_group_count = 0;
     }
 
 #ifndef NDEBUG
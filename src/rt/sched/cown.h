@@ -107,9 +107,21 @@ namespace verona::rt
 
     std::atomic<Slot*> last_slot{nullptr};
 
+    /**
+     * Access metadata for choosing cowns to swap out, only maintained while
+     * access tracking is enabled.  `num_accesses` is approximate, as racing
+     * increments may be lost.  `last_access` is the coarse access epoch of the
+     * last acquisition.
+     */
     std::atomic_uint64_t num_accesses{0};
     std::atomic_uint64_t num_fetches{0};
-    std::chrono::steady_clock::time_point last_access;
+    std::atomic<uint32_t> last_access{0};
+
+    /**
+     * Core that last ran a behaviour on this cown, only maintained while cown
+     * affinity is enabled, see `Scheduler::set_affinity`.
+     */
+    std::atomic<Core*> home_core{nullptr};
 
     /*
      * Cown's read ref count.
@@ -118,6 +130,13 @@ namespace verona::rt
      */
     ReadRefCount read_ref_count;
 
+    /**
+     * Writer waiting for the running readers to finish.  Set before the
+     * writer marks itself as waiting in `read_ref_count`, and resolved by the
+     * last reader to finish.
+     */
+    BehaviourCore* next_writer{nullptr};
+
   public:
 #ifdef USE_SYSTEMATIC_TESTING_WEAK_NOTICEBOARDS
     std::vector<BaseNoticeboard*> noticeboards;
@@ -166,44 +185,5 @@ namespace verona::rt
     //   Scheduler::local()->message_body = nullptr;
     //   notified();
     // }
-
-  public:
-    // bool release_early()
-    // {
-    //   auto* body = Scheduler::local()->message_body;
-    //   auto* senders = body->get_requests_array();
-    //   const size_t senders_count = body->count;
-    //   Alloc& alloc = ThreadAlloc::get();
-
-    //   /*
-    //    * Avoid releasing the last cown because it breaks the current
-    //    * code structure
-    //    */
-    //   if (this == senders[senders_count - 1].cown())
-    //     return false;
-
-    //   for (size_t s = 0; s < senders_count; s++)
-    //   {
-    //     if (senders[s].cown() != this)
-    //       continue;
-
-    //     if (
-    //       !senders[s].is_read() ||
-    //       senders[s].cown()->read_ref_count.release_read())
-    //     {
-    //       senders[s].cown()->schedule();
-    //     }
-    //     else
-    //     {
-    //       Cown::release(alloc, senders[s].cown());
-    //     }
-
-    //     senders[s] = Request();
-
-    //     break;
-    //   }
-
-    //   return true;
-    // }
   };
 } // namespace verona::rt
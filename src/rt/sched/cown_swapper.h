@@ -4,79 +4,173 @@
 #include "work.h"
 
 #include <type_traits>
-#include <fstream>
-#include <filesystem>
 #include <sstream>
+#include <string>
 #include <optional>
+#include <algorithm>
+#include <cstring>
+#include <deque>
+#include <vector>
+
+#include <sys/uio.h>
 
 namespace verona::rt
 {
     class BehaviourCore;
     using cown_pair = std::pair<Cown *, size_t>;
 
-    class CownSwapper {
-    private:
-        static std::filesystem::path get_cown_dir()
+    /// Memory of one or more cowns' values that is written to, or read from, the swap store directly.
+    ///
+    /// When swapping out, the values have already been detached from their cowns and are owned by the buffers until
+    /// the write completes, as is the serialized data of cowns without zero-copy support. When fetching, the buffers
+    /// point into the cown's newly allocated value.
+    struct SwapBuffers
+    {
+        std::vector<iovec> iov;
+        std::vector<std::pair<void*, void (*)(void*)>> owners;
+        /// A deque, so the data does not move as more is added.
+        std::deque<std::string> data;
+
+        SwapBuffers() = default;
+        SwapBuffers(const SwapBuffers&) = delete;
+        SwapBuffers& operator=(const SwapBuffers&) = delete;
+
+        ~SwapBuffers()
         {
-            namespace fs = std::filesystem;
-            fs::path cown_dir = fs::temp_directory_path() / "verona-rt" / "cowns";
+            for (auto& [owner, release] : owners)
+                release(owner);
+        }
 
-            // should be called once at the start of the runtime
-            fs::create_directories(cown_dir);
-            fs::permissions(cown_dir, fs::perms::owner_all);
+        void add(void* data, size_t size)
+        {
+            iov.push_back({data, size});
+        }
 
-            return cown_dir;
+        /// Keep `owner` alive until the buffers are destroyed.
+        void own(void* owner, void (*release)(void*))
+        {
+            owners.emplace_back(owner, release);
         }
 
-    public:
-        /// @param count Number of cowns being swapped.
-        /// @param cowns Array of cowns to be swapped.
-        /// @param to_be_swapped Atomic variable indicating the number of swap behaviours that can concurrently exist.
-        /// @return The function used by the swap behaviour.
-        static auto get_swap_lambda(size_t count, Cown** cowns, std::atomic_uint64_t& to_be_swapped)
+        /// Take ownership of `bytes` and add them to the buffers.
+        void add(std::string&& bytes)
+        {
+            auto& held = data.emplace_back(std::move(bytes));
+            add(held.data(), held.size());
+        }
+
+        size_t size() const
         {
-            auto swap_lambda = [=, &to_be_swapped]()
+            size_t total = 0;
+            for (auto& buffer : iov)
+                total += buffer.iov_len;
+            return total;
+        }
+
+        /// @return A copy of `size` bytes starting `offset` bytes into the buffers.
+        std::string copy(size_t offset, size_t size) const
+        {
+            std::string bytes;
+            bytes.reserve(size);
+            for (auto& buffer : iov)
             {
-                auto cown_dir = get_cown_dir();
-                for (size_t i = 0; i < count; ++i)
+                if (bytes.size() == size)
+                    break;
+
+                if (offset >= buffer.iov_len)
                 {
-                    std::stringstream filename;
-                    filename << cowns[i] << ".cown";
-                    std::fstream ofs(cown_dir / filename.str(), std::ios::out | std::ios::binary);
+                    offset -= buffer.iov_len;
+                    continue;
+                }
 
-                    cowns[i]->serialize(ofs);
+                auto length = std::min(buffer.iov_len - offset, size - bytes.size());
+                bytes.append((const char*)buffer.iov_base + offset, length);
+                offset = 0;
+            }
+            return bytes;
+        }
+    };
 
-                    ofs.flush();
-                    ofs.close();
-                }
+    class CownSwapper {
+    private:
+        /// Whether scheduling records accesses to cowns. Only enabled while a memory thread is running.
+        static inline std::atomic<bool> access_tracking{false};
+        /// Coarse clock for access times, advanced by the memory thread.
+        static inline std::atomic<uint32_t> access_epoch{0};
+        /// Whether a swap whose cown is requested again before its write completes hands the data straight to the
+        /// fetch.
+        static inline std::atomic<bool> readahead{false};
+
+    public:
+        /// @brief Serialize the cown's value, releasing it from memory.
+        /// @return The serialized value.
+        static std::string swap_out(Cown *cown)
+        {
+            std::stringstream archive(std::ios::in | std::ios::out | std::ios::binary);
+            cown->serialize(archive);
+            return archive.str();
+        }
+
+        /// @brief Restore the cown's value from the result of `swap_out`.
+        static void swap_in(Cown *cown, std::string&& data)
+        {
+            std::stringstream archive(std::move(data), std::ios::in | std::ios::out | std::ios::binary);
+            cown->serialize(archive);
+        }
+
+        /// @return True if the cown's value can be swapped without being copied, using the overloads below.
+        static bool is_zero_copy(Cown *cown)
+        {
+            return cown->has_gatherer();
+        }
 
-                to_be_swapped.fetch_sub(1);
-                auto& alloc = ThreadAlloc::get();
-                alloc.dealloc(cowns);
-            };
-            
-            return swap_lambda;
+        /// @brief Detach the cown's value, appending its memory to `buffers`. The value is freed with the buffers.
+        /// Cowns without zero-copy support are serialized into the buffers instead.
+        /// @return The number of bytes appended.
+        static size_t swap_out(Cown *cown, SwapBuffers& buffers)
+        {
+            size_t first = buffers.iov.size();
+            if (is_zero_copy(cown))
+                cown->gather(buffers);
+            else
+                buffers.add(swap_out(cown));
+
+            size_t size = 0;
+            for (size_t i = first; i < buffers.iov.size(); ++i)
+                size += buffers.iov[i].iov_len;
+            return size;
         }
 
-        /// @param cown Cown to be fetched.
-        /// @param register_to_thread The callback function to inform the swapping thread that the cown is back in
-        /// memory.
-        /// @return The function used by the fetch behaviour. 
-        static auto get_fetch_lambda(cown_pair cown, std::function<void(cown_pair)> register_to_thread)
+        /// @brief Restore the cown's value from the bytes of its record, whichever way it was swapped out.
+        static void swap_in_from(Cown *cown, std::string&& data)
         {
-            return [cown, register_to_thread]()
+            if (!is_zero_copy(cown))
             {
-                auto cown_dir = get_cown_dir();
-                std::stringstream filename;
-                filename << cown.first << ".cown";
-                std::fstream ifs(cown_dir / filename.str(), std::ios::in | std::ios::binary);
+                swap_in(cown, std::move(data));
+                return;
+            }
 
-                cown.first->serialize(ifs);
-                
-                ifs.close();
+            SwapBuffers buffers;
+            swap_in(cown, data.size(), buffers);
 
-                register_to_thread(cown);
-            };
+            size_t offset = 0;
+            for (auto& buffer : buffers.iov)
+            {
+                std::memcpy(buffer.iov_base, data.data() + offset, buffer.iov_len);
+                offset += buffer.iov_len;
+            }
+        }
+
+        /// @brief Allocate a new value for a record of `size` bytes, describing where to read it into in `buffers`.
+        static void swap_in(Cown *cown, size_t size, SwapBuffers& buffers)
+        {
+            cown->scatter(size, buffers);
+            if (buffers.size() != size)
+            {
+                Logging::cout() << "Cown " << cown << " scattered " << buffers.size() << " bytes, expected " << size
+                                << Logging::endl;
+                abort();
+            }
         }
 
         /// @brief Perform a weak acquire on the cown to prevent it from being freed while the swapping thread holds it.
@@ -91,15 +185,24 @@ namespace verona::rt
             cown->weak_release(ThreadAlloc::get());
         }
 
-        static bool set_swapped(Cown *cown)
+        static bool is_swapped(Cown *cown)
         {
-            if (!cown->swapped)
-            {
-                cown->swapped = true;
-                return true;
-            }
+            return cown->swapped.load(std::memory_order_relaxed);
+        }
 
-            return false;
+        static bool is_readahead()
+        {
+            return readahead.load(std::memory_order_relaxed);
+        }
+
+        static void set_readahead(bool enabled)
+        {
+            readahead.store(enabled, std::memory_order_relaxed);
+        }
+
+        static bool set_swapped(Cown *cown)
+        {
+            return !cown->swapped.exchange(true, std::memory_order_relaxed);
         }
  
         static bool was_accessed(Cown *cown)
@@ -109,14 +212,28 @@ namespace verona::rt
             return prev > 0;
         }
 
+        /// @brief Called for every cown acquired by a behaviour. Records the access if tracking is enabled, using
+        /// only plain loads and stores.
+        /// @return True if the cown was swapped out, and needs to be fetched.
         static bool set_in_memory(Cown *cown)
         {
-            ++cown->num_accesses;
-            cown->last_access = std::chrono::steady_clock::now();
-            if (cown->swapped)
+#ifndef NO_ACCESS_TRACKING
+            if (access_tracking.load(std::memory_order_relaxed))
+            {
+                auto accesses = cown->num_accesses.load(std::memory_order_relaxed);
+                cown->num_accesses.store(accesses + 1, std::memory_order_relaxed);
+
+                // Avoid dirtying the cache line if the epoch has not moved on.
+                auto epoch = access_epoch.load(std::memory_order_relaxed);
+                if (cown->last_access.load(std::memory_order_relaxed) != epoch)
+                    cown->last_access.store(epoch, std::memory_order_relaxed);
+            }
+#endif
+
+            if (cown->swapped.load(std::memory_order_relaxed))
             {
                 ++cown->num_fetches;
-                cown->swapped = false;
+                cown->swapped.store(false, std::memory_order_relaxed);
                 return true;
             }
 
@@ -128,9 +245,21 @@ namespace verona::rt
             return cown->num_accesses;
         }
 
-        static std::chrono::steady_clock::time_point get_last_access(Cown *cown)
+        /// @return Number of access epochs since the cown was last acquired. Robust to the epoch wrapping around.
+        static uint32_t get_access_age(Cown *cown)
+        {
+            return access_epoch.load(std::memory_order_relaxed) - cown->last_access.load(std::memory_order_relaxed);
+        }
+
+        static void set_access_tracking(bool enabled)
+        {
+            access_tracking.store(enabled, std::memory_order_relaxed);
+        }
+
+        /// @brief Advance the coarse clock used for access times.
+        static void advance_access_epoch()
         {
-            return cown->last_access;
+            access_epoch.fetch_add(1, std::memory_order_relaxed);
         }
 
         static uint64_t debug_get_fetches(Cown *cown)
@@ -0,0 +1,124 @@
+// Copyright Microsoft and Project Verona Contributors.
+// SPDX-License-Identifier: MIT
+#pragma once
+
+#include "work.h"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <snmalloc/snmalloc.h>
+
+namespace verona::rt
+{
+  /**
+   * Fixed capacity queue of work ordered by deadline, earliest first.
+   *
+   * A binary min-heap under a spin lock.  It holds only work that was given a
+   * deadline, so is usually empty, and `earliest` lets the owner and thieves
+   * check that without taking the lock.  Pushing to a full queue fails, and
+   * the work should be scheduled without its deadline instead.
+   */
+  template<size_t N = 256>
+  class DeadlineQueue
+  {
+    struct Entry
+    {
+      uint64_t deadline;
+      Work* work;
+    };
+
+    snmalloc::FlagWord lock;
+    size_t count = 0;
+    Entry heap[N];
+
+    /// Deadline of the top of the heap, or `NO_DEADLINE` if empty.
+    std::atomic<uint64_t> top_deadline{NO_DEADLINE};
+
+    void sift_up(size_t i)
+    {
+      while (i > 0)
+      {
+        size_t parent = (i - 1) / 2;
+        if (heap[parent].deadline <= heap[i].deadline)
+          return;
+        std::swap(heap[parent], heap[i]);
+        i = parent;
+      }
+    }
+
+    void sift_down(size_t i)
+    {
+      while (true)
+      {
+        size_t least = i;
+        size_t left = (2 * i) + 1;
+        size_t right = left + 1;
+        if (left < count && heap[left].deadline < heap[least].deadline)
+          least = left;
+        if (right < count && heap[right].deadline < heap[least].deadline)
+          least = right;
+        if (least == i)
+          return;
+        std::swap(heap[least], heap[i]);
+        i = least;
+      }
+    }
+
+    void update_top()
+    {
+      top_deadline.store(
+        count == 0 ? NO_DEADLINE : heap[0].deadline, std::memory_order_release);
+    }
+
+  public:
+    /**
+     * Add work that should run by `deadline`.
+     * @return false if the queue is full.
+     */
+    bool push(Work* work, uint64_t deadline)
+    {
+      snmalloc::FlagLock f(lock);
+      if (count == N)
+        return false;
+
+      heap[count] = {deadline, work};
+      sift_up(count++);
+      update_top();
+      return true;
+    }
+
+    /**
+     * Take the work with the earliest deadline, or nullptr if empty.
+     */
+    Work* pop()
+    {
+      if (empty())
+        return nullptr;
+
+      snmalloc::FlagLock f(lock);
+      if (count == 0)
+        return nullptr;
+
+      Work* work = heap[0].work;
+      heap[0] = heap[--count];
+      sift_down(0);
+      update_top();
+      return work;
+    }
+
+    /**
+     * The earliest deadline in the queue, or `NO_DEADLINE` if it is empty.
+     * Approximate unless the queue is quiescent.
+     */
+    uint64_t earliest()
+    {
+      return top_deadline.load(std::memory_order_acquire);
+    }
+
+    bool empty()
+    {
+      return earliest() == NO_DEADLINE;
+    }
+  };
+} // namespace verona::rt
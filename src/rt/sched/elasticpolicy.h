@@ -0,0 +1,52 @@
+// Copyright Microsoft and Project Verona Contributors.
+// SPDX-License-Identifier: MIT
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <snmalloc/snmalloc.h>
+
+namespace verona::rt
+{
+  /**
+   * How the number of active cores, and so of running scheduler threads,
+   * changes while the runtime runs.
+   */
+  enum class ElasticPolicy
+  {
+    /// Only changed by `Scheduler::set_active_cores`.
+    Fixed,
+    /// Also grown while every active core has work waiting and no thread is
+    /// idle, and shrunk while threads are idle, within configured bounds.
+    Auto,
+  };
+
+  /**
+   * Rate limits the decisions of `ElasticPolicy::Auto`.  Scheduler threads
+   * offer to decide as they go idle and between batches, and at most one
+   * offer per period is taken, so the pool changes by at most one core per
+   * period, and the checks cost little in between.
+   */
+  class ElasticClock
+  {
+    /// Ticks between decisions.
+    static constexpr uint64_t PERIOD = 10'000'000;
+
+    std::atomic<uint64_t> next_decision{0};
+
+  public:
+    /**
+     * Returns true if the caller should make the next decision.
+     */
+    bool due()
+    {
+      auto next = next_decision.load(std::memory_order_relaxed);
+      auto now = snmalloc::Aal::tick();
+      if (now < next)
+        return false;
+
+      return next_decision.compare_exchange_strong(
+        next, now + PERIOD, std::memory_order_relaxed);
+    }
+  };
+} // namespace verona::rt
@@ -85,6 +85,18 @@ namespace verona::rt
       b->next_in_queue.store(node, std::memory_order_release);
     }
 
+    /**
+     * Enqueue a segment of nodes, already linked through `next_in_queue` from
+     * `first` to `last`, as a single enqueue.
+     */
+    void enqueue_segment(T* first, T* last)
+    {
+      last->next_in_queue.store(nullptr, std::memory_order_relaxed);
+      auto b = back.exchange(last, std::memory_order_seq_cst);
+      assert(b->next_in_queue == nullptr);
+      b->next_in_queue.store(first, std::memory_order_release);
+    }
+
     void enqueue_front(T* node)
     {
       auto cmp = front.read();
@@ -139,6 +151,68 @@ namespace verona::rt
       return fnt;
     }
 
+    /**
+     * Take up to `max` elements from the queue with a single update of
+     * `front`, but no more than half of the elements observed, rounded up.
+     * This is used to steal a share of another queue's work at once.
+     *
+     * The first element is returned as by `dequeue`.  The rest remain linked
+     * through `next_in_queue`, from `rest` to `last`, and must be enqueued
+     * again with `enqueue_segment`, as their epoch has not been recorded.
+     * `rest` is nullptr if only one element was taken.  This may spuriously
+     * fail, in the same way as `dequeue`.
+     */
+    T* dequeue_segment(Alloc& alloc, size_t max, T*& rest, T*& last)
+    {
+      T* fnt;
+      T* next;
+
+      // Hold epoch to ensure that the elements read from the queue cannot be
+      // deallocated during this operation.
+      Epoch e(alloc);
+      uint64_t epoch = e.get_local_epoch_epoch();
+
+      auto cmp = front.read();
+      do
+      {
+        fnt = cmp.ptr();
+        last = fnt;
+
+        // Walk up to twice as many elements as will be taken, moving `last`
+        // along at half the speed.  The walk is memory safe due to holding the
+        // epoch, and if any of it is stale, then `front` has moved and the
+        // store below fails.
+        size_t observed = 0;
+        T* curr = fnt;
+        while (observed < 2 * max)
+        {
+          next = curr->next_in_queue.load(std::memory_order_acquire);
+          if (next == nullptr)
+            break;
+
+          observed++;
+          curr = next;
+          if ((observed % 2 == 1) && (observed > 1))
+            last = last->next_in_queue.load(std::memory_order_acquire);
+        }
+
+        if (observed == 0)
+          return nullptr;
+
+        next = last->next_in_queue.load(std::memory_order_acquire);
+        if (next == nullptr)
+          return nullptr;
+      } while (!cmp.store_conditional(next));
+
+      assert(epoch != T::NO_EPOCH_SET);
+
+      // The epoch shares storage with the link, so read the link first.
+      rest = fnt == last ? nullptr : fnt->next_in_queue.load();
+      fnt->epoch_when_popped = epoch;
+
+      return fnt;
+    }
+
     // The callers are expected to guarantee no one is attempting to access the
     // queue concurrently.
     void destroy(Alloc& alloc)
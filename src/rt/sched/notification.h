@@ -92,11 +92,11 @@ namespace verona::rt
       auto* slots = notification->behaviour->get_slots();
       for (size_t i = 0; i < notification->behaviour->count; i++)
       {
-        Shared::release(ThreadAlloc::get(), slots[i].cown);
+        Shared::release(ThreadAlloc::get(), slots[i].cown());
       }
 
       // Need to dealloc using ABA protection for fields relating to work.
-      notification->behaviour->as_work()->dealloc();
+      notification->behaviour->dealloc();
     }
 
     /**
@@ -207,7 +207,8 @@ namespace verona::rt
       for (size_t i = 0; i < count; i++)
       {
         Shared::acquire(requests[i].cown());
-        new (&slots[i]) Slot(requests[i].cown());
+        new (&slots[i])
+          Slot(requests[i].cown(), behaviour_core, requests[i].is_read());
       }
 
       return notification;
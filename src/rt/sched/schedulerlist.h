@@ -64,6 +64,13 @@ namespace verona::rt
       free.insert_back(thread);
     }
 
+    void move_free_to_active(T* thread)
+    {
+      snmalloc::FlagLock lock(m);
+      free.remove(thread);
+      active.insert_back(thread);
+    }
+
     // Applies f on all active and free threads.
     // WARNING: do not call other methods on the list or we end up with
     // deadlock.
@@ -2,6 +2,7 @@
 // SPDX-License-Identifier: MIT
 #pragma once
 
+#include <algorithm>
 #include <iostream>
 #include <snmalloc/snmalloc.h>
 
@@ -40,11 +41,23 @@ namespace verona::rt
   private:
 #ifdef USE_SCHED_STATS
     std::atomic<size_t> steal_count{0};
+    /// Steals, including fast steals, by `Topology::Distance` to the victim.
+    std::array<std::atomic<size_t>, 4> steal_distance_count{};
     std::atomic<size_t> pause_count{0};
     std::atomic<size_t> unpause_count{0};
     std::atomic<size_t> lifo_count{0};
     std::array<std::atomic<size_t>, 16> behaviour_count{};
     std::atomic<size_t> cown_count{0};
+    /// Behaviours by the time from being ready to running, in power of two
+    /// buckets of ticks, the first for under 2^10 ticks.  The last bucket
+    /// takes every delay of 2^24 ticks or more.
+    std::array<std::atomic<size_t>, 16> queueing_delay_count{};
+    std::atomic<size_t> queueing_delay_total{0};
+    std::atomic<size_t> deadline_miss_count{0};
+    /// Ready behaviours that ran on, or were routed to, the home core of
+    /// their first cown, and those kept local as it was overloaded.
+    std::atomic<size_t> affinity_hit_count{0};
+    std::atomic<size_t> affinity_miss_count{0};
 #endif
   public:
     ~SchedulerStats()
@@ -63,10 +76,22 @@ namespace verona::rt
       = default;
 #endif
 
-    void steal()
+    void steal(size_t distance)
     {
 #ifdef USE_SCHED_STATS
       steal_count++;
+#endif
+      steal_distance(distance);
+    }
+
+    void steal_distance(size_t distance)
+    {
+      UNUSED(distance);
+#ifdef USE_SCHED_STATS
+      if (distance < steal_distance_count.size())
+        steal_distance_count[distance]++;
+      else
+        steal_distance_count.back()++;
 #endif
     }
 
@@ -109,6 +134,38 @@ namespace verona::rt
 #endif
     }
 
+    /**
+     * A behaviour started running `delay` ticks after it was ready, and
+     * `missed_deadline` if it had a deadline that has passed.
+     */
+    void queueing_delay(uint64_t delay, bool missed_deadline)
+    {
+      UNUSED(delay);
+      UNUSED(missed_deadline);
+#ifdef USE_SCHED_STATS
+      queueing_delay_total += delay;
+
+      size_t bucket = 0;
+      for (delay >>= 10; delay != 0; delay >>= 1)
+        bucket++;
+      queueing_delay_count[std::min(bucket, queueing_delay_count.size() - 1)]++;
+
+      if (missed_deadline)
+        deadline_miss_count++;
+#endif
+    }
+
+    void affinity(bool hit)
+    {
+      UNUSED(hit);
+#ifdef USE_SCHED_STATS
+      if (hit)
+        affinity_hit_count++;
+      else
+        affinity_miss_count++;
+#endif
+    }
+
     void add(SchedulerStats& that)
     {
       UNUSED(that);
@@ -119,9 +176,19 @@ namespace verona::rt
       unpause_count += that.unpause_count;
       lifo_count += that.lifo_count;
       cown_count += that.cown_count;
+      queueing_delay_total += that.queueing_delay_total;
+      deadline_miss_count += that.deadline_miss_count;
+      affinity_hit_count += that.affinity_hit_count;
+      affinity_miss_count += that.affinity_miss_count;
+
+      for (size_t i = 0; i < steal_distance_count.size(); i++)
+        steal_distance_count[i] += that.steal_distance_count[i];
 
       for (size_t i = 0; i < behaviour_count.size(); i++)
         behaviour_count[i] += that.behaviour_count[i];
+
+      for (size_t i = 0; i < queueing_delay_count.size(); i++)
+        queueing_delay_count[i] += that.queueing_delay_count[i];
 #endif
     }
 
@@ -144,19 +211,41 @@ namespace verona::rt
             << "LIFO"
             << "Pause"
             << "Unpause"
-            << "Cown count";
+            << "Cown count"
+            << "Steal sibling"
+            << "Steal cache"
+            << "Steal node"
+            << "Steal remote";
 
         for (size_t i = 0; i < behaviour_count.size(); i++)
           csv << i;
 
+        csv << "Delay total"
+            << "Deadline miss"
+            << "Affinity hit"
+            << "Affinity miss";
+
+        for (size_t i = 0; i + 1 < queueing_delay_count.size(); i++)
+          csv << ("Delay <2^" + std::to_string(i + 10));
+        csv << ("Delay >=2^" + std::to_string(queueing_delay_count.size() + 8));
+
         csv << std::endl;
       }
 
       csv << "SchedulerStats" << get_tag() << dumpid << steal_count
           << lifo_count << pause_count << unpause_count << cown_count;
 
+      for (size_t i = 0; i < steal_distance_count.size(); i++)
+        csv << steal_distance_count[i];
+
       for (size_t i = 0; i < behaviour_count.size(); i++)
         csv << behaviour_count[i];
+
+      csv << queueing_delay_total << deadline_miss_count << affinity_hit_count
+          << affinity_miss_count;
+
+      for (size_t i = 0; i < queueing_delay_count.size(); i++)
+        csv << queueing_delay_count[i];
       csv << std::endl;
 
       steal_count = 0;
@@ -165,8 +254,19 @@ namespace verona::rt
       lifo_count = 0;
       cown_count = 0;
 
+      for (size_t i = 0; i < steal_distance_count.size(); i++)
+        steal_distance_count[i] = 0;
+
       for (size_t i = 0; i < behaviour_count.size(); i++)
         behaviour_count[i] = 0;
+
+      queueing_delay_total = 0;
+      deadline_miss_count = 0;
+      affinity_hit_count = 0;
+      affinity_miss_count = 0;
+
+      for (size_t i = 0; i < queueing_delay_count.size(); i++)
+        queueing_delay_count[i] = 0;
 #endif
     }
 
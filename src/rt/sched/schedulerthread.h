@@ -3,6 +3,8 @@
 #pragma once
 
 #include "../debug/systematic.h"
+#include "batchpolicy.h"
+#include "behaviourpool.h"
 #include "core.h"
 #include "ds/dllist.h"
 #include "ds/hashmap.h"
@@ -11,8 +13,10 @@
 #include "schedulerlist.h"
 #include "schedulerstats.h"
 #include "threadpool.h"
+#include "workdeque.h"
 
 #include <snmalloc/snmalloc.h>
+#include <thread>
 
 namespace verona::rt
 {
@@ -35,6 +39,10 @@ namespace verona::rt
     /// Friendly thread identifier for logging information.
     size_t systematic_id = 0;
 
+    /// Work routed to another core by cown affinity that it can fall behind
+    /// on, before it counts as overloaded.
+    static constexpr size_t AFFINITY_BACKLOG = 16;
+
   private:
     using Scheduler = ThreadPool<SchedulerThread>;
     friend Scheduler;
@@ -44,8 +52,6 @@ namespace verona::rt
     template<typename Owner>
     friend class Noticeboard;
 
-    static constexpr uint64_t TSC_QUIESCENCE_TIMEOUT = 1'000'000;
-
     Core* core = nullptr;
 #ifdef USE_SYSTEMATIC_TESTING
     friend class ThreadSyncSystematic<SchedulerThread>;
@@ -56,12 +62,35 @@ namespace verona::rt
 #endif
 
     Alloc* alloc = nullptr;
-    Core* victim = nullptr;
+    /// Index into `core->victims` of the next core to steal from.
+    size_t victim = 0;
 
     /// Local work item to avoid overhead of synchronisation
     /// on scheduler queue.
     Work* next_work = nullptr;
 
+    /// Work scheduled by this thread that has been displaced from
+    /// `next_work`.  Only this thread pushes and pops, so it avoids the
+    /// atomic updates of `core->q`, but other cores can steal from it.
+    WorkDeque<Work> local_work;
+
+    /// Size of the current batch, and how the next one is sized under
+    /// `BatchPolicy::Adaptive`.
+    size_t batch_size = 0;
+    BatchSizer batch_sizer{0};
+
+    /// Whether deadline work, rather than the core's queue, has the next
+    /// normal priority turn.
+    bool deadline_turn = true;
+
+    /// Memory of behaviours finished on this thread, for it to create more.
+    BehaviourPool behaviour_pool;
+
+    /// Work to run as soon as the current work item finishes, and how many
+    /// more may follow it like that, see `ThreadPool::coalesce`.
+    Work* coalesced = nullptr;
+    size_t coalesce_left = 0;
+
     bool running = true;
 
     /// SchedulerList pointers.
@@ -85,10 +114,30 @@ namespace verona::rt
       running = false;
     }
 
-    inline void schedule_fifo(Work* w)
+    bool coalesce(Work* w)
+    {
+      if (coalesced != nullptr || coalesce_left == 0)
+        return false;
+
+      coalesce_left--;
+      coalesced = w;
+      return true;
+    }
+
+    inline void schedule_fifo(Work* w, Priority priority = Priority::Normal)
     {
       Logging::cout() << "Enqueue work " << w << Logging::endl;
 
+      // Work of another priority goes to the core's queue for it, where it is
+      // taken in priority order, and ends the current batch if high.
+      if (priority != Priority::Normal)
+      {
+        core->queue(priority).enqueue(w);
+        if (Scheduler::get().unpause(core))
+          core->stats.unpause();
+        return;
+      }
+
       // If we already have a work item then we need to enqueue it.
       return_next_work();
 
@@ -96,22 +145,68 @@ namespace verona::rt
       next_work = w;
     }
 
-    static inline void schedule_lifo(Core* c, Work* w)
+    static inline void
+    schedule_lifo(Core* c, Work* w, Priority priority = Priority::Normal)
     {
       // A lifo scheduled cown is coming from an external source, such as
       // asynchronous I/O.
       Logging::cout() << "LIFO scheduling work " << w << " onto " << c->affinity
                       << Logging::endl;
-      c->q.enqueue_front(w);
+      c->queue(priority).enqueue_front(w);
       Logging::cout() << "LIFO scheduled work " << w << " onto " << c->affinity
                       << Logging::endl;
 
       c->stats.lifo();
 
-      if (Scheduler::get().unpause())
+      if (Scheduler::get().unpause(c))
+        c->stats.unpause();
+    }
+
+    static inline void schedule_deadline(Core* c, Work* w, uint64_t deadline)
+    {
+      Logging::cout() << "Deadline " << deadline << " scheduling work " << w
+                      << " onto " << c->affinity << Logging::endl;
+
+      // The deadline queue only fills under extreme load, when the deadline
+      // is unlikely to be met anyway.
+      if (!c->deadlines.push(w, deadline))
+        c->q.enqueue(w);
+
+      if (Scheduler::get().unpause(c))
         c->stats.unpause();
     }
 
+    inline void schedule_affine(Core* home, Work* w, Priority priority)
+    {
+      // Already home, so keep it local for batching.
+      if (home == core)
+      {
+        core->stats.affinity(true);
+        schedule_fifo(w, priority);
+        return;
+      }
+
+      if (
+        home->retired.load(std::memory_order_relaxed) ||
+        home->affinity_backlog.load(std::memory_order_relaxed) >=
+          AFFINITY_BACKLOG)
+      {
+        core->stats.affinity(false);
+        schedule_fifo(w, priority);
+        return;
+      }
+
+      Logging::cout() << "Affinity scheduling work " << w << " onto "
+                      << home->affinity << Logging::endl;
+
+      home->affinity_backlog.fetch_add(1, std::memory_order_relaxed);
+      home->queue(priority).enqueue(w);
+      core->stats.affinity(true);
+
+      if (Scheduler::get().unpause(home))
+        core->stats.unpause();
+    }
+
     template<typename... Args>
     static void run(SchedulerThread* t, void (*startup)(Args...), Args... args)
     {
@@ -122,33 +217,204 @@ namespace verona::rt
     {
       if (next_work != nullptr)
       {
-        core->q.enqueue(next_work);
+        if (!local_work.push(next_work))
+          core->q.enqueue(next_work);
         next_work = nullptr;
-        if (Scheduler::get().unpause())
+        if (Scheduler::get().unpause(core))
+          core->stats.unpause();
+      }
+    }
+
+    /**
+     * Move the work left in the local deque onto the core's queue, oldest
+     * first, behind the token and any work scheduled by other threads.
+     */
+    void flush_local_work()
+    {
+      Work* first = nullptr;
+      Work* last = nullptr;
+
+      // Take from the thieves' end to keep the order, retrying when racing
+      // a thief.
+      while (!local_work.empty())
+      {
+        auto w = local_work.steal();
+        if (w == nullptr)
+          continue;
+
+        if (first == nullptr)
+          first = w;
+        else
+          last->next_in_queue.store(w, std::memory_order_relaxed);
+        last = w;
+      }
+
+      if (first != nullptr)
+      {
+        core->q.enqueue_segment(first, last);
+        if (Scheduler::get().unpause(core))
           core->stats.unpause();
       }
     }
 
-    static constexpr size_t BATCH_SIZE = 100;
+    /**
+     * Size the next batch, after `ran` work items in the last one.
+     */
+    size_t next_batch_size(size_t ran)
+    {
+      if (Scheduler::get_batch_policy() == BatchPolicy::Fixed)
+        return Scheduler::get_batch_size();
+
+      // Work from other threads, or the token, is waiting behind this batch.
+      bool waiting = !core->q.nothing_old();
+      return batch_sizer.next_batch(ran, waiting);
+    }
+
+    /**
+     * Take normal priority work.  Work with a deadline is taken earliest
+     * deadline first, taking turns with the core's queue so neither starves
+     * the other.
+     */
+    Work* dequeue_normal()
+    {
+      Work* work;
+
+      if (deadline_turn && (work = core->deadlines.pop()) != nullptr)
+      {
+        deadline_turn = false;
+        return work;
+      }
+
+      deadline_turn = true;
+      if ((work = core->q.dequeue(*alloc)) != nullptr)
+        return work;
+
+      if (core->deadlines.empty())
+        return nullptr;
+
+      // Nothing in the queue to cycle its token, so give low priority work
+      // the turn it would have had.
+      core->low_turn = true;
+      return core->deadlines.pop();
+    }
+
+    /**
+     * Work has been taken from this core's queues, so reduce the backlog of
+     * work routed here by cown affinity.
+     */
+    void reduce_affinity_backlog()
+    {
+      auto backlog = core->affinity_backlog.load(std::memory_order_relaxed);
+
+      // Another thread servicing this core may race us, so only ever take
+      // off what we saw, and give up if it changed.
+      if (backlog != 0)
+        core->affinity_backlog.compare_exchange_strong(
+          backlog, backlog - 1, std::memory_order_relaxed);
+    }
+
+    /**
+     * Take work from this core's queues, highest priority first.  A lower
+     * priority queue is taken from first once the token of the queue above it
+     * has come round, so it is not starved.
+     */
+    Work* dequeue_by_priority()
+    {
+      Work* work;
+
+      if (core->low_turn)
+      {
+        core->low_turn = false;
+        if ((work = core->low_q.dequeue(*alloc)) != nullptr)
+          return work;
+      }
+
+      if (core->normal_turn)
+      {
+        core->normal_turn = false;
+        if ((work = dequeue_normal()) != nullptr)
+          return work;
+
+        // Nothing at normal priority to cycle its token, so pass the turn
+        // down, or low priority work would starve behind high.
+        if (
+          !core->low_q.nothing_old() &&
+          (work = core->low_q.dequeue(*alloc)) != nullptr)
+          return work;
+      }
+
+      if (
+        !core->high_q.nothing_old() &&
+        (work = core->high_q.dequeue(*alloc)) != nullptr)
+        return work;
+
+      if ((work = dequeue_normal()) != nullptr)
+        return work;
+
+      if (!core->low_q.nothing_old())
+        return core->low_q.dequeue(*alloc);
+
+      return nullptr;
+    }
+
     Work* get_work(size_t& batch)
     {
+      // High priority and deadline work end the batch early, so they do not
+      // wait behind local work.
+      if (
+        batch != 0 &&
+        (!core->high_q.nothing_old() || !core->deadlines.empty()))
+        batch = 0;
+
       // Check if we have a thread-local work item to use that is not subject
       // to work stealing.  This is batched, and should not happen more than
-      // BATCH_SIZE times in a row.
+      // batch_size times in a row.
       if (next_work != nullptr && batch != 0)
       {
         batch--;
         return std::exchange(next_work, nullptr);
       }
 
-      batch = BATCH_SIZE;
+      // Then the most recent work displaced into the local deque, within the
+      // same batch.
+      if (batch != 0)
+      {
+        auto work = local_work.pop();
+        if (work != nullptr)
+        {
+          batch--;
+          return work;
+        }
+      }
+
+      batch = batch_size = next_batch_size(batch_size - batch);
+
+      // At the end of a batch, anything still local joins the core's queue,
+      // so it takes its turn with the token and work from other threads
+      // rather than running ahead of them indefinitely.
+      flush_local_work();
+
+      Scheduler::get().elastic_check(false);
+
+      // The pool has shrunk below this core, so leave all local work to be
+      // stolen, and park.
+      if (core->retired.load(std::memory_order_relaxed))
+      {
+        return_next_work();
+        flush_local_work();
+        Scheduler::get().retire();
+
+        // Torn down while parked, so the other cores' queues may be gone.
+        if (!running)
+          return nullptr;
+      }
 
       if (core->should_steal_for_fairness)
       {
         // Can race with other threads on the same core.
         // This is a heuristic, so we don't care.
         core->should_steal_for_fairness = false;
-        auto work = try_steal();
+        auto work = try_steal(false);
         if (work != nullptr)
         {
           return_next_work();
@@ -156,16 +422,17 @@ namespace verona::rt
         }
       }
 
-      auto work = core->q.dequeue(*alloc);
+      auto work = dequeue_by_priority();
       if (work != nullptr)
       {
+        reduce_affinity_backlog();
         return_next_work();
         return work;
       }
 
       // Our queue is effectively empty, so this is like receiving a token,
       // try a steal.
-      work = try_steal();
+      work = try_steal(true);
       if (work != nullptr)
       {
         return_next_work();
@@ -177,7 +444,11 @@ namespace verona::rt
         return std::exchange(next_work, nullptr);
       }
 
-      return steal();
+      work = steal();
+
+      // Time spent idle is not part of the next batch.
+      batch_sizer.start_batch();
+      return work;
     }
 
     /**
@@ -194,31 +465,57 @@ namespace verona::rt
       Scheduler::local() = this;
       alloc = &ThreadAlloc::get();
       assert(core != nullptr);
-      victim = core->next;
+      victim = 0;
       core->servicing_threads++;
 
+      // Only one of the threads servicing a core can offer its deque to
+      // thieves.  The others still use theirs, it is just not stolen from.
+      WorkDeque<Work>* unregistered = nullptr;
+      core->local_work.compare_exchange_strong(unregistered, &local_work);
+
 #ifdef USE_SYSTEMATIC_TESTING
       Systematic::attach_systematic_thread(local_systematic);
 #endif
-      size_t batch = BATCH_SIZE;
+      batch_size = Scheduler::get_batch_size();
+      batch_sizer = BatchSizer(batch_size);
+      batch_sizer.start_batch();
+      size_t batch = batch_size;
       Work* work;
       while ((work = get_work(batch)))
       {
         Logging::cout() << "Schedule work " << work << Logging::endl;
 
-        work->run();
+        // Behaviours run back to back count towards the batch, so the thread
+        // still gets round to its other work in time.
+        coalesce_left = std::min(Scheduler::get_coalesce_budget(), batch);
+        auto budget = coalesce_left;
+        do
+        {
+          work->run();
 
-        yield();
+          yield();
+        } while ((work = std::exchange(coalesced, nullptr)) != nullptr);
+        batch -= budget - coalesce_left;
+        coalesce_left = 0;
       }
 
+      assert(local_work.empty());
+
+      behaviour_pool.flush();
+
       if (core != nullptr)
       {
+        WorkDeque<Work>* registered = &local_work;
+        core->local_work.compare_exchange_strong(registered, nullptr);
+
         auto val = core->servicing_threads.fetch_sub(1);
         if (val == 1)
         {
           Logging::cout() << "Destroying core " << core->affinity
                           << Logging::endl;
           core->q.destroy(*alloc);
+          core->high_q.destroy(*alloc);
+          core->low_q.destroy(*alloc);
         }
       }
 
@@ -229,25 +526,122 @@ namespace verona::rt
       Scheduler::local() = nullptr;
     }
 
-    Work* try_steal()
+    /**
+     * The next core to steal from, moving through the victims of this core
+     * nearest first, or nullptr if there are no other cores.
+     */
+    Core::Victim* next_victim()
+    {
+      auto& victims = core->victims;
+      if (victims.empty())
+        return nullptr;
+
+      if (victim >= victims.size())
+        victim = 0;
+
+      return &victims[victim++];
+    }
+
+    /**
+     * Take work from the queue of `v`.  If `batch` is set, this takes a share
+     * of its queue with one update, keeping the first item to run and moving
+     * the rest onto this core's queue, so an idle core catches up with a burst
+     * of work in a single steal.
+     */
+    Work* steal_shared(Core* v, bool batch)
+    {
+      if (!batch)
+        return v->q.dequeue(*alloc);
+
+      Work* rest = nullptr;
+      Work* last = nullptr;
+      auto work =
+        v->q.dequeue_segment(*alloc, Scheduler::get_steal_batch(), rest, last);
+
+      if (work != nullptr && rest != nullptr)
+      {
+        Logging::cout() << "Stole work " << rest << " to " << last << " from "
+                        << v->affinity << Logging::endl;
+        core->q.enqueue_segment(rest, last);
+        if (Scheduler::get().unpause(core))
+          core->stats.unpause();
+      }
+
+      return work;
+    }
+
+    /**
+     * The other core with the work nearest its deadline, or nullptr if no
+     * other core has deadline work.  Deadline work is rare, so this is
+     * usually a load of one word per core.
+     */
+    Core::Victim* earliest_victim()
+    {
+      Core::Victim* best = nullptr;
+      uint64_t earliest = NO_DEADLINE;
+
+      for (auto& v : core->victims)
+      {
+        auto deadline = v.core->deadlines.earliest();
+        if (deadline < earliest)
+        {
+          earliest = deadline;
+          best = &v;
+        }
+      }
+
+      return best;
+    }
+
+    /**
+     * Take work from `v`: its high priority queue, its deadline work, its
+     * normal queue, the oldest item in the deque of the thread servicing it,
+     * and finally its low priority queue.
+     */
+    Work* steal_from(Core* v, bool batch)
+    {
+      Work* work;
+      if (!v->high_q.nothing_old() && (work = v->high_q.dequeue(*alloc)))
+        return work;
+
+      if ((work = v->deadlines.pop()) != nullptr)
+        return work;
+
+      if ((work = steal_shared(v, batch)) != nullptr)
+        return work;
+
+      auto deque = v->local_work.load(std::memory_order_acquire);
+      if (
+        deque != nullptr && deque != &local_work &&
+        (work = deque->steal()) != nullptr)
+        return work;
+
+      if (!v->low_q.nothing_old())
+        return v->low_q.dequeue(*alloc);
+
+      return nullptr;
+    }
+
+    Work* try_steal(bool batch)
     {
       Work* work = nullptr;
-      // Try to steal from the victim thread.
-      if (victim != core)
+      // Try to steal the work nearest its deadline, otherwise from the victim
+      // thread, and move on to the next.
+      auto v = earliest_victim();
+      if (v == nullptr)
+        v = next_victim();
+      if (v != nullptr)
       {
-        work = victim->q.dequeue(*alloc);
+        work = steal_from(v->core, batch);
 
         if (work != nullptr)
         {
-          // stats.steal();
+          core->stats.steal_distance(v->distance);
           Logging::cout() << "Fast-steal work " << work << " from "
-                          << victim->affinity << Logging::endl;
+                          << v->core->affinity << Logging::endl;
         }
       }
 
-      // Move to the next victim thread.
-      victim = victim->next;
-
       return work;
     }
 
@@ -256,33 +650,41 @@ namespace verona::rt
       uint64_t tsc = Aal::tick();
       Work* work;
 
+      // Look for work in the nearest cores first, only moving further away
+      // as they turn out to be empty.
+      victim = 0;
+
       while (running)
       {
         yield();
 
-        // Check if some other thread has pushed work on our queue.
-        work = core->q.dequeue(*alloc);
+        // Check if some other thread has pushed work on our queues.
+        work = dequeue_by_priority();
 
         if (work != nullptr)
+        {
+          reduce_affinity_backlog();
           return work;
+        }
 
-        // Try to steal from the victim thread.
-        if (victim != core)
+        // Try to steal the work nearest its deadline, otherwise from the
+        // victim thread, and move on to the next.
+        auto v = earliest_victim();
+        if (v == nullptr)
+          v = next_victim();
+        if (v != nullptr)
         {
-          work = victim->q.dequeue(*alloc);
+          work = steal_from(v->core, true);
 
           if (work != nullptr)
           {
-            core->stats.steal();
+            core->stats.steal(v->distance);
             Logging::cout() << "Stole work " << work << " from "
-                            << victim->affinity << Logging::endl;
+                            << v->core->affinity << Logging::endl;
             return work;
           }
         }
 
-        // We were unable to steal, move to the next victim thread.
-        victim = victim->next;
-
 #ifdef USE_SYSTEMATIC_TESTING
         // Only try to pause with 1/(2^5) probability
         UNUSED(tsc);
@@ -292,15 +694,30 @@ namespace verona::rt
           continue;
         }
 #else
-        // Wait until a minimum timeout has passed.
-        uint64_t tsc2 = Aal::tick();
-        if ((tsc2 - tsc) < TSC_QUIESCENCE_TIMEOUT)
+        // Spin, then yield the CPU, until the park thresholds have passed.
+        uint64_t idle = Aal::tick() - tsc;
+        uint64_t spin = Scheduler::get_spin_ticks();
+        if (idle < spin)
         {
           Aal::pause();
           continue;
         }
+
+        if (idle < spin + Scheduler::get_yield_ticks())
+        {
+          std::this_thread::yield();
+          continue;
+        }
 #endif
 
+        Scheduler::get().elastic_check(true);
+
+        // Park until restored if the pool has shrunk below this core.
+        if (
+          core->retired.load(std::memory_order_relaxed) &&
+          Scheduler::get().retire())
+          continue;
+
         // We've been spinning looking for work for some time. While paused,
         // our running flag may be set to false, in which case we terminate.
         if (Scheduler::get().pause())
@@ -39,7 +39,7 @@ namespace verona::rt
 
     BehaviourCore *fetch_behaviour{nullptr};
     void (*fetch_deallocator)(BehaviourCore *);
-    bool swapped{false};
+    std::atomic<bool> swapped{false};
 
     friend class BehaviourCore;
     friend class CownSwapper;
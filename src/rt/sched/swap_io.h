@@ -0,0 +1,490 @@
+#pragma once
+
+#include "../debug/logging.h"
+#include "cown_swapper.h"
+#include "schedulerthread.h"
+#include "work.h"
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <cerrno>
+#include <climits>
+#include <sys/uio.h>
+
+#if defined(USE_IO_URING) && defined(__linux__)
+#include <cstring>
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace verona::rt
+{
+    /// A single read or write of a record in the swap store.
+    struct SwapIORequest
+    {
+        enum class Op
+        {
+            Read,
+            Write
+        };
+
+        Op op;
+        int fd{-1};
+        size_t offset{0};
+        /// Data to write, or a buffer sized to the record to read into.
+        std::string buffer;
+        /// If not empty, the record is transferred directly to or from these instead of `buffer`.
+        SwapBuffers buffers;
+        bool success{false};
+
+        /// @return The regions of memory the request transfers.
+        std::vector<iovec> regions()
+        {
+            if (!buffers.iov.empty())
+                return buffers.iov;
+            return {{buffer.data(), buffer.size()}};
+        }
+    };
+
+    /// Drops the first `n` bytes of the regions from `first` onwards, skipping any that become empty.
+    inline void advance_regions(std::vector<iovec>& iov, size_t& first, size_t n)
+    {
+        while (first < iov.size() && n >= iov[first].iov_len)
+        {
+            n -= iov[first].iov_len;
+            ++first;
+        }
+
+        if (first < iov.size())
+        {
+            iov[first].iov_base = (char*)iov[first].iov_base + n;
+            iov[first].iov_len -= n;
+        }
+    }
+
+    /// A group of requests submitted together. Once every request has completed, `on_complete` is passed to
+    /// `Scheduler::schedule`.
+    struct SwapIOBatch
+    {
+        std::vector<SwapIORequest> requests;
+        std::atomic<size_t> remaining{0};
+        Work* on_complete{nullptr};
+
+        SwapIOBatch(size_t count) : requests(count) {}
+    };
+
+    /// Performs a request on the calling thread.
+    inline void perform_swap_io(SwapIORequest& request)
+    {
+        auto iov = request.regions();
+        size_t first = 0;
+        size_t offset = request.offset;
+        advance_regions(iov, first, 0);
+
+        while (first < iov.size())
+        {
+            auto count = (int)std::min<size_t>(iov.size() - first, IOV_MAX);
+            auto n = request.op == SwapIORequest::Op::Write ? ::pwritev(request.fd, &iov[first], count, (off_t)offset)
+                                                            : ::preadv(request.fd, &iov[first], count, (off_t)offset);
+            if (n < 0 && errno == EINTR)
+                continue;
+            if (n <= 0)
+            {
+                request.success = false;
+                return;
+            }
+
+            offset += n;
+            advance_regions(iov, first, n);
+        }
+
+        request.success = true;
+    }
+
+    /// Backend performing the requests on a small pool of dedicated threads using blocking I/O.
+    class ThreadPoolSwapIO
+    {
+    private:
+        std::mutex mutex;
+        std::condition_variable cv;
+        std::deque<std::pair<SwapIORequest*, SwapIOBatch*>> queue;
+        std::vector<std::thread> workers;
+        bool stop{false};
+
+        void run(void (*complete)(SwapIOBatch*))
+        {
+            while (true)
+            {
+                std::pair<SwapIORequest*, SwapIOBatch*> item;
+                {
+                    std::unique_lock<std::mutex> lock(mutex);
+                    cv.wait(lock, [this]() { return stop || !queue.empty(); });
+                    if (queue.empty())
+                        return;
+
+                    item = queue.front();
+                    queue.pop_front();
+                }
+
+                perform_swap_io(*item.first);
+                complete(item.second);
+            }
+        }
+
+    public:
+        ThreadPoolSwapIO(size_t threads, void (*complete)(SwapIOBatch*))
+        {
+            for (size_t i = 0; i < threads; ++i)
+                workers.emplace_back([this, complete]() { run(complete); });
+        }
+
+        ~ThreadPoolSwapIO()
+        {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                stop = true;
+            }
+            cv.notify_all();
+
+            for (auto& worker : workers)
+                worker.join();
+        }
+
+        void submit(SwapIORequest* request, SwapIOBatch* batch)
+        {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                queue.emplace_back(request, batch);
+            }
+            cv.notify_one();
+        }
+    };
+
+#if defined(USE_IO_URING) && defined(__linux__)
+    /// Backend using a single io_uring instance. The reads and writes are performed by the kernel, and a dedicated
+    /// thread reaps completions.
+    class UringSwapIO
+    {
+    private:
+        /// An in flight request. Short reads and writes are resubmitted for the remainder.
+        struct Operation
+        {
+            SwapIORequest* request;
+            SwapIOBatch* batch;
+            std::vector<iovec> iov;
+            size_t first{0};
+            size_t done{0};
+        };
+
+        void (*complete)(SwapIOBatch*);
+
+        int ring_fd{-1};
+        unsigned entries{0};
+
+        void* sq_ptr{nullptr};
+        size_t sq_size{0};
+        void* cq_ptr{nullptr};
+        size_t cq_size{0};
+        io_uring_sqe* sqes{nullptr};
+
+        unsigned* sq_tail;
+        unsigned* sq_mask;
+        unsigned* sq_array;
+        unsigned* cq_head;
+        unsigned* cq_tail;
+        unsigned* cq_mask;
+        io_uring_cqe* cqes;
+
+        std::mutex mutex;
+        std::condition_variable space;
+        unsigned in_flight{0};
+
+        std::thread reaper;
+
+        static int enter(int fd, unsigned to_submit, unsigned min_complete, unsigned flags)
+        {
+            return (int)syscall(__NR_io_uring_enter, fd, to_submit, min_complete, flags, nullptr, 0);
+        }
+
+        /// Push a single entry onto the submission queue. A user_data of zero is used to stop the reaper.
+        void push(uint8_t opcode, int fd, void* addr, size_t len, size_t offset, uint64_t user_data)
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            space.wait(lock, [this]() { return in_flight < entries; });
+
+            unsigned tail = *sq_tail;
+            unsigned index = tail & *sq_mask;
+            io_uring_sqe* sqe = &sqes[index];
+            std::memset(sqe, 0, sizeof(*sqe));
+            sqe->opcode = opcode;
+            sqe->fd = fd;
+            sqe->addr = (uint64_t)addr;
+            sqe->len = (uint32_t)len;
+            sqe->off = offset;
+            sqe->user_data = user_data;
+            sq_array[index] = index;
+            __atomic_store_n(sq_tail, tail + 1, __ATOMIC_RELEASE);
+            ++in_flight;
+
+            while (enter(ring_fd, 1, 0, 0) < 0 && errno == EINTR)
+            {}
+        }
+
+        void push(Operation* op)
+        {
+            auto& request = *op->request;
+            auto opcode = request.op == SwapIORequest::Op::Write ? IORING_OP_WRITEV : IORING_OP_READV;
+            auto count = std::min<size_t>(op->iov.size() - op->first, IOV_MAX);
+            push(opcode, request.fd, &op->iov[op->first], count, request.offset + op->done, (uint64_t)op);
+        }
+
+        void finish(Operation* op, bool success)
+        {
+            op->request->success = success;
+            auto batch = op->batch;
+            delete op;
+            complete(batch);
+        }
+
+        /// Returns false once the stop entry has been seen.
+        bool on_completion(uint64_t user_data, int res)
+        {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                --in_flight;
+            }
+            space.notify_one();
+
+            if (user_data == 0)
+                return false;
+
+            auto op = (Operation*)user_data;
+            if (res <= 0)
+            {
+                finish(op, false);
+                return true;
+            }
+
+            op->done += res;
+            advance_regions(op->iov, op->first, res);
+            if (op->first < op->iov.size())
+                push(op);
+            else
+                finish(op, true);
+
+            return true;
+        }
+
+        void reap()
+        {
+            bool running = true;
+            while (running)
+            {
+                if (enter(ring_fd, 0, 1, IORING_ENTER_GETEVENTS) < 0 && errno != EINTR)
+                    abort();
+
+                unsigned head = *cq_head;
+                unsigned tail = __atomic_load_n(cq_tail, __ATOMIC_ACQUIRE);
+                while (head != tail)
+                {
+                    auto& cqe = cqes[head & *cq_mask];
+                    running &= on_completion(cqe.user_data, cqe.res);
+                    ++head;
+                }
+                __atomic_store_n(cq_head, head, __ATOMIC_RELEASE);
+            }
+        }
+
+    public:
+        UringSwapIO(unsigned requested_entries, void (*complete)(SwapIOBatch*)) : complete(complete)
+        {
+            io_uring_params params;
+            std::memset(&params, 0, sizeof(params));
+            ring_fd = (int)syscall(__NR_io_uring_setup, requested_entries, &params);
+            if (ring_fd < 0)
+                return;
+
+            entries = params.sq_entries;
+            sq_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+            cq_size = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+            bool single_mmap = params.features & IORING_FEAT_SINGLE_MMAP;
+            if (single_mmap)
+                sq_size = cq_size = std::max(sq_size, cq_size);
+
+            sq_ptr = mmap(nullptr, sq_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd,
+                          IORING_OFF_SQ_RING);
+            cq_ptr = single_mmap ? sq_ptr : mmap(nullptr, cq_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                                                 ring_fd, IORING_OFF_CQ_RING);
+            auto sqes_ptr = mmap(nullptr, params.sq_entries * sizeof(io_uring_sqe), PROT_READ | PROT_WRITE,
+                                 MAP_SHARED | MAP_POPULATE, ring_fd, IORING_OFF_SQES);
+            if (sq_ptr == MAP_FAILED || cq_ptr == MAP_FAILED || sqes_ptr == MAP_FAILED)
+            {
+                close(ring_fd);
+                ring_fd = -1;
+                return;
+            }
+
+            sqes = (io_uring_sqe*)sqes_ptr;
+            sq_tail = (unsigned*)((char*)sq_ptr + params.sq_off.tail);
+            sq_mask = (unsigned*)((char*)sq_ptr + params.sq_off.ring_mask);
+            sq_array = (unsigned*)((char*)sq_ptr + params.sq_off.array);
+            cq_head = (unsigned*)((char*)cq_ptr + params.cq_off.head);
+            cq_tail = (unsigned*)((char*)cq_ptr + params.cq_off.tail);
+            cq_mask = (unsigned*)((char*)cq_ptr + params.cq_off.ring_mask);
+            cqes = (io_uring_cqe*)((char*)cq_ptr + params.cq_off.cqes);
+
+            reaper = std::thread([this]() { reap(); });
+        }
+
+        ~UringSwapIO()
+        {
+            if (ring_fd < 0)
+                return;
+
+            push(IORING_OP_NOP, -1, nullptr, 0, 0, 0);
+            reaper.join();
+
+            munmap(sqes, entries * sizeof(io_uring_sqe));
+            if (cq_ptr != sq_ptr)
+                munmap(cq_ptr, cq_size);
+            munmap(sq_ptr, sq_size);
+            close(ring_fd);
+        }
+
+        /// False if the kernel refused to create the ring.
+        bool is_available()
+        {
+            return ring_fd >= 0;
+        }
+
+        void submit(SwapIORequest* request, SwapIOBatch* batch)
+        {
+            auto op = new Operation{request, batch, request->regions()};
+            advance_regions(op->iov, op->first, 0);
+            if (op->first == op->iov.size())
+            {
+                finish(op, true);
+                return;
+            }
+
+            push(op);
+        }
+    };
+#endif
+
+    /// Asynchronous I/O for swapping cowns in and out of memory.
+    ///
+    /// A swap or fetch behaviour submits a batch and suspends itself. Scheduler threads keep running other behaviours
+    /// while the I/O is in flight, and the behaviour is rescheduled, still holding its cowns, once the whole batch has
+    /// completed. An external event source is held while a batch is in flight so the runtime is not torn down.
+    ///
+    /// With USE_IO_URING on Linux the requests are performed with io_uring, falling back to a thread pool if the
+    /// kernel does not support it. Under systematic testing the requests are performed synchronously.
+    class SwapIO
+    {
+    private:
+        static constexpr size_t DEFAULT_THREADS = 2;
+        static constexpr unsigned URING_ENTRIES = 256;
+
+        std::unique_ptr<ThreadPoolSwapIO> thread_pool;
+#if defined(USE_IO_URING) && defined(__linux__)
+        std::unique_ptr<UringSwapIO> uring;
+#endif
+
+        SwapIO()
+        {
+#if defined(USE_IO_URING) && defined(__linux__)
+            uring = std::make_unique<UringSwapIO>(URING_ENTRIES, complete);
+            if (uring->is_available())
+                return;
+            uring.reset();
+#endif
+            thread_pool = std::make_unique<ThreadPoolSwapIO>(DEFAULT_THREADS, complete);
+        }
+
+        static SwapIO& get()
+        {
+            static SwapIO io;
+            return io;
+        }
+
+        static void complete(SwapIOBatch* batch)
+        {
+            if (batch->remaining.fetch_sub(1, std::memory_order_acq_rel) == 1)
+                Scheduler::schedule(batch->on_complete);
+        }
+
+        void submit(SwapIORequest* request, SwapIOBatch* batch)
+        {
+#if defined(USE_IO_URING) && defined(__linux__)
+            if (uring)
+            {
+                uring->submit(request, batch);
+                return;
+            }
+#endif
+            thread_pool->submit(request, batch);
+        }
+
+    public:
+        /// Submit every request in the batch. This must be the last thing the calling behaviour does, and
+        /// `on_complete` should be the result of `Behaviour::suspend`.
+        static void submit(SwapIOBatch* batch, Work* on_complete)
+        {
+            Logging::cout() << "SwapIO submit " << batch->requests.size() << " requests" << Logging::endl;
+
+            Scheduler::add_external_event_source();
+            batch->on_complete = on_complete;
+            batch->remaining.store(batch->requests.size(), std::memory_order_release);
+
+            if (batch->requests.empty())
+            {
+                Scheduler::schedule(on_complete);
+                return;
+            }
+
+#ifdef USE_SYSTEMATIC_TESTING
+            for (auto& request : batch->requests)
+            {
+                perform_swap_io(request);
+                complete(batch);
+            }
+#else
+            // Take the count up front, as the batch can complete before the loop finishes.
+            auto count = batch->requests.size();
+            auto requests = batch->requests.data();
+            auto& io = get();
+            for (size_t i = 0; i < count; ++i)
+                io.submit(&requests[i], batch);
+#endif
+        }
+
+        /// Called by the resumed behaviour once the batch has completed. Deallocates the batch.
+        static void finish(SwapIOBatch* batch)
+        {
+            Scheduler::remove_external_event_source();
+
+            for (auto& request : batch->requests)
+            {
+                if (!request.success)
+                {
+                    Logging::cout() << "SwapIO failed on fd " << request.fd << " at " << request.offset << Logging::endl;
+                    abort();
+                }
+            }
+
+            delete batch;
+        }
+    };
+
+} // namespace verona::rt
@@ -0,0 +1,136 @@
+#pragma once
+
+#include "cown.h"
+
+#include <array>
+#include <atomic>
+#include <mutex>
+#include <unordered_map>
+
+namespace verona::rt
+{
+    /// Remembers which cowns were acquired together with a cown the last time it had to be fetched, so they can be
+    /// prefetched the next time it is fetched, before a behaviour asks for them.
+    ///
+    /// Correlations are only recorded by behaviours that triggered a fetch, and only while enabled, so scheduling
+    /// in memory cowns pays nothing beyond a flag check. The table holds weak references to the correlated cowns,
+    /// which are released by `clear`. Reference counts are only changed outside the lock, as they can yield under
+    /// systematic testing.
+    class FetchCorrelations
+    {
+    public:
+        /// Correlated cowns remembered per cown.
+        static constexpr size_t WIDTH = 4;
+
+    private:
+        /// Cowns with correlations remembered before the table is cleared.
+        static constexpr size_t CAPACITY = 1 << 16;
+
+        using Entry = std::array<Cown*, WIDTH>;
+
+        std::atomic<bool> enabled{false};
+        std::mutex mutex;
+        std::unordered_map<Cown*, Entry> table;
+
+        static void release(Entry& entry)
+        {
+            for (auto correlated : entry)
+            {
+                if (correlated != nullptr)
+                    correlated->weak_release(ThreadAlloc::get());
+            }
+        }
+
+    public:
+        static FetchCorrelations& get()
+        {
+            static FetchCorrelations correlations;
+            return correlations;
+        }
+
+        bool is_enabled()
+        {
+            return enabled.load(std::memory_order_relaxed);
+        }
+
+        void set_enabled(bool value)
+        {
+            enabled.store(value, std::memory_order_relaxed);
+            if (!value)
+                clear();
+        }
+
+        /// Remember `others` as the cowns acquired with `cown` when it was fetched. `others` must be distinct and
+        /// not contain `cown`. Only the first `WIDTH` are kept.
+        void record(Cown* cown, Cown** others, size_t count)
+        {
+            Entry entry{};
+            for (size_t i = 0; i < count && i < WIDTH; ++i)
+            {
+                others[i]->weak_acquire();
+                entry[i] = others[i];
+            }
+
+            Entry old{};
+            std::unordered_map<Cown*, Entry> full;
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                if (table.size() >= CAPACITY)
+                    full.swap(table);
+
+                auto [it, inserted] = table.try_emplace(cown, entry);
+                if (!inserted)
+                    std::swap(old, it->second);
+                it->second = entry;
+            }
+
+            release(old);
+            for (auto& [key, value] : full)
+                release(value);
+        }
+
+        /// Find the live cowns correlated with `cown`, acquiring a strong reference to each.
+        /// @return The number of cowns written to `out`, which must have space for `WIDTH`.
+        size_t take(Cown* cown, Cown** out)
+        {
+            // Hold our own weak references, as the entry can be replaced once the lock is dropped.
+            Entry entry{};
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                auto it = table.find(cown);
+                if (it == table.end())
+                    return 0;
+
+                entry = it->second;
+                for (auto correlated : entry)
+                {
+                    if (correlated != nullptr)
+                        correlated->weak_acquire();
+                }
+            }
+
+            size_t count = 0;
+            for (auto correlated : entry)
+            {
+                if (correlated != nullptr && correlated->acquire_strong_from_weak())
+                    out[count++] = correlated;
+            }
+
+            release(entry);
+            return count;
+        }
+
+        /// Forget every correlation, releasing the weak references held.
+        void clear()
+        {
+            std::unordered_map<Cown*, Entry> old;
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                old.swap(table);
+            }
+
+            for (auto& [cown, entry] : old)
+                release(entry);
+        }
+    };
+} // namespace verona::rt
@@ -0,0 +1,463 @@
+#pragma once
+
+#include "../debug/logging.h"
+#include "cown.h"
+
+#include <cassert>
+#include <chrono>
+#include <condition_variable>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace verona::rt
+{
+    /// Reads or writes `size` bytes at `offset`, retrying short transfers.
+    /// @return True if all the bytes were transferred.
+    inline bool pread_all(int fd, char* data, size_t size, size_t offset)
+    {
+        while (size > 0)
+        {
+            auto n = ::pread(fd, data, size, (off_t)offset);
+            if (n < 0 && errno == EINTR)
+                continue;
+            if (n <= 0)
+                return false;
+
+            data += n;
+            offset += n;
+            size -= n;
+        }
+        return true;
+    }
+
+    inline bool pwrite_all(int fd, const char* data, size_t size, size_t offset)
+    {
+        while (size > 0)
+        {
+            auto n = ::pwrite(fd, data, size, (off_t)offset);
+            if (n < 0 && errno == EINTR)
+                continue;
+            if (n <= 0)
+                return false;
+
+            data += n;
+            offset += n;
+            size -= n;
+        }
+        return true;
+    }
+
+    /// Log-structured store for swapped out cowns.
+    ///
+    /// Records are appended to a small number of preallocated segment files, rather than using a file per cown,
+    /// so swapping does not pay for creating, opening and closing a file each time. An in-memory index maps each
+    /// swapped out cown to its record. Each segment tracks its live bytes; a full segment whose records are all dead
+    /// is reused, and a background thread compacts full segments that are mostly dead by copying their live records
+    /// to the end of the log.
+    ///
+    /// A record is written in three steps: `allocate` reserves the space, the caller writes it, and `commit` makes
+    /// it visible to compaction. A record is read with `lookup`, which pins the segment so it cannot be reused while
+    /// the read is in flight, followed by `release`, which removes the record.
+    class SwapStore
+    {
+    public:
+        /// Where a record lives. `segment` is only meaningful to the store.
+        struct Location
+        {
+            int fd{-1};
+            size_t offset{0};
+            size_t size{0};
+            size_t segment{0};
+        };
+
+    private:
+        static constexpr size_t SEGMENT_SIZE = 64 * 1024 * 1024;
+        /// Full segments with less than this fraction of live bytes are compacted.
+        static constexpr double COMPACT_THRESHOLD = 0.5;
+        static constexpr auto COMPACT_INTERVAL = std::chrono::milliseconds(100);
+
+        struct Segment
+        {
+            int fd;
+            size_t capacity;
+            size_t write_offset{0};
+            size_t live{0};
+            /// Number of reads, and compactions, in progress.
+            size_t pins{0};
+            /// Set once the segment is full, and cleared when it is reused.
+            bool sealed{false};
+
+            Segment(int fd, size_t capacity) : fd(fd), capacity(capacity) {}
+        };
+
+        struct Entry
+        {
+            size_t segment;
+            size_t offset;
+            size_t size;
+            bool committed{false};
+        };
+
+        std::filesystem::path directory;
+
+        std::mutex mutex;
+        std::vector<std::unique_ptr<Segment>> segments;
+        std::vector<size_t> free_segments;
+        size_t active{0};
+        std::unordered_map<Cown*, Entry> index;
+        /// Records that are also still in memory, because the cown was requested again while being swapped out.
+        std::unordered_map<Cown*, std::string> readahead;
+
+        std::condition_variable compact_cv;
+        bool stop{false};
+        std::thread compactor;
+
+        SwapStore()
+        {
+            namespace fs = std::filesystem;
+            std::stringstream name;
+            name << "swap-" << getpid();
+            directory = fs::temp_directory_path() / "verona-rt" / name.str();
+
+            fs::create_directories(directory);
+            fs::permissions(directory, fs::perms::owner_all);
+
+            active = new_segment(SEGMENT_SIZE);
+            compactor = std::thread([this]() { compact_loop(); });
+        }
+
+        ~SwapStore()
+        {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                stop = true;
+            }
+            compact_cv.notify_all();
+            compactor.join();
+
+            for (auto& segment : segments)
+                close(segment->fd);
+
+            std::error_code ec;
+            std::filesystem::remove_all(directory, ec);
+        }
+
+        /// Creates and preallocates a new segment file. Called with the lock held, or during construction.
+        size_t new_segment(size_t capacity)
+        {
+            std::stringstream name;
+            name << "segment-" << segments.size();
+            auto path = directory / name.str();
+
+            int fd = open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0600);
+            if (fd < 0)
+            {
+                Logging::cout() << "SwapStore failed to create " << path.c_str() << Logging::endl;
+                abort();
+            }
+
+#ifdef __linux__
+            // Best effort, space is still allocated on demand if this fails.
+            posix_fallocate(fd, 0, (off_t)capacity);
+#endif
+
+            segments.push_back(std::make_unique<Segment>(fd, capacity));
+            return segments.size() - 1;
+        }
+
+        /// Reserves space at the end of the log. Called with the lock held.
+        size_t reserve(size_t size, size_t& offset)
+        {
+            if (size > SEGMENT_SIZE)
+            {
+                // Oversized records get a segment of their own.
+                auto s = new_segment(size);
+                auto* segment = segments[s].get();
+                segment->write_offset = size;
+                segment->live = size;
+                segment->sealed = true;
+                offset = 0;
+                return s;
+            }
+
+            if (segments[active]->write_offset + size > segments[active]->capacity)
+            {
+                auto old = active;
+                segments[old]->sealed = true;
+
+                if (!free_segments.empty())
+                {
+                    active = free_segments.back();
+                    free_segments.pop_back();
+                }
+                else
+                {
+                    active = new_segment(SEGMENT_SIZE);
+                }
+
+                maybe_free(old);
+            }
+
+            auto* segment = segments[active].get();
+            offset = segment->write_offset;
+            segment->write_offset += size;
+            segment->live += size;
+            return active;
+        }
+
+        /// Marks `size` bytes of a segment as dead. Called with the lock held.
+        void kill(size_t s, size_t size)
+        {
+            segments[s]->live -= size;
+            maybe_free(s);
+            if (segments[s]->sealed && segments[s]->live < segments[s]->capacity * COMPACT_THRESHOLD)
+                compact_cv.notify_one();
+        }
+
+        /// Reuses a full segment once all its records are dead. Called with the lock held.
+        void maybe_free(size_t s)
+        {
+            auto* segment = segments[s].get();
+            if (!segment->sealed || segment->live != 0 || segment->pins != 0)
+                return;
+
+            segment->sealed = false;
+            segment->write_offset = 0;
+
+            if (segment->capacity == SEGMENT_SIZE)
+            {
+                free_segments.push_back(s);
+            }
+            else
+            {
+                // Oversized segments are not reused, but keep their slot so the indices stay stable.
+                [[maybe_unused]] auto result = ftruncate(segment->fd, 0);
+                segment->capacity = 0;
+                segment->sealed = true;
+            }
+        }
+
+        /// Picks a full segment with few live bytes, or returns false.
+        bool pick_compaction(size_t& s)
+        {
+            for (size_t i = 0; i < segments.size(); ++i)
+            {
+                auto* segment = segments[i].get();
+                if (segment->sealed && segment->capacity == SEGMENT_SIZE && segment->live > 0 &&
+                    segment->live < segment->capacity * COMPACT_THRESHOLD && segment->pins == 0)
+                {
+                    s = i;
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        /// Copies the live records of segment `s` to the end of the log.
+        void compact(size_t s)
+        {
+            std::vector<std::pair<Cown*, Entry>> records;
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                // The pin stops the segment being reused while records are copied out of it.
+                segments[s]->pins++;
+                for (auto& [cown, entry] : index)
+                {
+                    if (entry.segment == s && entry.committed)
+                        records.emplace_back(cown, entry);
+                }
+            }
+
+            Logging::cout() << "SwapStore compacting segment " << s << " with " << records.size() << " records"
+                            << Logging::endl;
+
+            std::string buffer;
+            for (auto& [cown, old] : records)
+            {
+                size_t dest_offset;
+                size_t dest;
+                int src_fd;
+                int dest_fd;
+                {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    auto it = index.find(cown);
+                    if (it == index.end() || it->second.segment != s || it->second.offset != old.offset)
+                        continue;
+
+                    dest = reserve(old.size, dest_offset);
+                    src_fd = segments[s]->fd;
+                    dest_fd = segments[dest]->fd;
+                }
+
+                buffer.resize(old.size);
+                bool ok = pread_all(src_fd, buffer.data(), old.size, old.offset) &&
+                          pwrite_all(dest_fd, buffer.data(), old.size, dest_offset);
+
+                std::lock_guard<std::mutex> lock(mutex);
+                auto it = index.find(cown);
+                if (ok && it != index.end() && it->second.segment == s && it->second.offset == old.offset)
+                {
+                    it->second.segment = dest;
+                    it->second.offset = dest_offset;
+                    kill(s, old.size);
+                }
+                else
+                {
+                    // The cown was fetched while we copied it, so the copy is dead.
+                    kill(dest, old.size);
+                }
+            }
+
+            std::lock_guard<std::mutex> lock(mutex);
+            segments[s]->pins--;
+            maybe_free(s);
+        }
+
+        void compact_loop()
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            while (!stop)
+            {
+                size_t s;
+                if (pick_compaction(s))
+                {
+                    lock.unlock();
+                    compact(s);
+                    lock.lock();
+                    continue;
+                }
+
+                compact_cv.wait_for(lock, COMPACT_INTERVAL);
+            }
+        }
+
+    public:
+        static SwapStore& get()
+        {
+            static SwapStore store;
+            return store;
+        }
+
+        /// Reserves one contiguous record for a batch of cowns, laid out in order, where `sizes[i]` is the size of
+        /// the i-th cown. Each cown is then fetched, compacted and removed on its own.
+        /// @return The location of the whole record.
+        Location allocate(Cown** cowns, const size_t* sizes, size_t count)
+        {
+            size_t total = 0;
+            for (size_t i = 0; i < count; ++i)
+                total += sizes[i];
+
+            std::lock_guard<std::mutex> lock(mutex);
+            size_t offset;
+            auto s = reserve(total, offset);
+
+            size_t cown_offset = offset;
+            for (size_t i = 0; i < count; ++i)
+            {
+                assert(index.find(cowns[i]) == index.end());
+                index[cowns[i]] = {s, cown_offset, sizes[i]};
+                cown_offset += sizes[i];
+            }
+
+            return {segments[s]->fd, offset, total, s};
+        }
+
+        /// Called once the record allocated for the cown has been written.
+        void commit(Cown* cown)
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            index.at(cown).committed = true;
+        }
+
+        /// Finds the cown's record, and pins its segment until `release` is called.
+        Location lookup(Cown* cown)
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            auto& entry = index.at(cown);
+            assert(entry.committed);
+
+            auto* segment = segments[entry.segment].get();
+            segment->pins++;
+            return {segment->fd, entry.offset, entry.size, entry.segment};
+        }
+
+        /// Removes the cown's record once it has been read. `location` is the result of `lookup`.
+        void release(Cown* cown, const Location& location)
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            segments[location.segment]->pins--;
+
+            // Compaction may have moved the record since it was looked up.
+            auto it = index.find(cown);
+            assert(it != index.end());
+            kill(it->second.segment, it->second.size);
+            index.erase(it);
+
+            maybe_free(location.segment);
+        }
+
+        /// Removes the record of a cown that was deallocated while swapped out.
+        void discard(Cown* cown)
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            auto it = index.find(cown);
+            if (it == index.end())
+                return;
+
+            kill(it->second.segment, it->second.size);
+            index.erase(it);
+            readahead.erase(cown);
+        }
+
+        /// Keep a copy of the cown's record in memory, so fetching it does not need to read it back.
+        void stash(Cown* cown, std::string&& bytes)
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            readahead[cown] = std::move(bytes);
+        }
+
+        /// If the cown's record was stashed, removes the record and moves the copy into `bytes`.
+        /// @return True if the record was stashed.
+        bool take_stash(Cown* cown, std::string& bytes)
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            auto stashed = readahead.find(cown);
+            if (stashed == readahead.end())
+                return false;
+
+            bytes = std::move(stashed->second);
+            readahead.erase(stashed);
+
+            auto it = index.find(cown);
+            assert(it != index.end());
+            kill(it->second.segment, it->second.size);
+            index.erase(it);
+            return true;
+        }
+
+        /// Bytes of live records, and total bytes of segment files. For diagnostics.
+        std::pair<size_t, size_t> debug_usage()
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            size_t live = 0;
+            size_t capacity = 0;
+            for (auto& segment : segments)
+            {
+                live += segment->live;
+                capacity += segment->capacity;
+            }
+            return {live, capacity};
+        }
+    };
+
+} // namespace verona::rt
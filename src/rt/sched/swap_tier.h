@@ -0,0 +1,331 @@
+#pragma once
+
+#include "../debug/logging.h"
+#include "cown.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace verona::rt
+{
+    /// Compresses the records of cowns kept in the compressed tier. A codec is shared by every scheduler thread, so
+    /// implementations must be thread safe.
+    class SwapCodec
+    {
+    public:
+        virtual ~SwapCodec() = default;
+
+        /// Appends the compressed form of `size` bytes at `data` to `out`.
+        virtual void compress(const char* data, size_t size, std::string& out) = 0;
+
+        /// Decompresses `in` into the `size` bytes at `out`.
+        /// @return False if `in` does not decompress to exactly `size` bytes.
+        virtual bool decompress(const std::string& in, char* out, size_t size) = 0;
+    };
+
+    /// Byte oriented LZ77 codec, using the LZ4 block layout. Each sequence is a token holding the literal and match
+    /// lengths, the literals, then a two byte offset back into the last 64KiB of output. The last sequence has no
+    /// match. Matches are found with a single probe of a small hash table, favouring speed over ratio.
+    class LzCodec : public SwapCodec
+    {
+    private:
+        static constexpr size_t MIN_MATCH = 4;
+        static constexpr size_t HASH_BITS = 12;
+        static constexpr size_t WINDOW = 0xffff;
+        /// Lengths that do not fit in a token nibble continue in the following bytes.
+        static constexpr size_t NIBBLE = 15;
+
+        static uint32_t read32(const char* data)
+        {
+            uint32_t value;
+            std::memcpy(&value, data, sizeof(value));
+            return value;
+        }
+
+        static size_t hash(uint32_t value)
+        {
+            return (value * 2654435761u) >> (32 - HASH_BITS);
+        }
+
+        static void put_length(std::string& out, size_t length)
+        {
+            for (length -= NIBBLE; length >= 255; length -= 255)
+                out.push_back((char)255);
+            out.push_back((char)length);
+        }
+
+        static bool get_length(const uint8_t*& in, const uint8_t* end, size_t& length)
+        {
+            if (length != NIBBLE)
+                return true;
+
+            uint8_t byte;
+            do
+            {
+                if (in == end)
+                    return false;
+                byte = *in++;
+                length += byte;
+            } while (byte == 255);
+            return true;
+        }
+
+        /// A `match` of zero ends the output.
+        static void emit(std::string& out, const char* literals, size_t literal_length, size_t offset, size_t match)
+        {
+            size_t match_length = match == 0 ? 0 : match - MIN_MATCH;
+            out.push_back((char)((std::min(literal_length, NIBBLE) << 4) | std::min(match_length, NIBBLE)));
+            if (literal_length >= NIBBLE)
+                put_length(out, literal_length);
+            out.append(literals, literal_length);
+
+            if (match == 0)
+                return;
+
+            out.push_back((char)(offset & 0xff));
+            out.push_back((char)(offset >> 8));
+            if (match_length >= NIBBLE)
+                put_length(out, match_length);
+        }
+
+    public:
+        void compress(const char* data, size_t size, std::string& out) override
+        {
+            // Positions are stored plus one, so zero is empty.
+            std::vector<size_t> table(size_t(1) << HASH_BITS, 0);
+
+            size_t anchor = 0;
+            size_t i = 0;
+            while (i + MIN_MATCH <= size)
+            {
+                auto value = read32(data + i);
+                auto& slot = table[hash(value)];
+                size_t candidate = slot;
+                slot = i + 1;
+
+                if (candidate == 0 || i + 1 - candidate > WINDOW || read32(data + candidate - 1) != value)
+                {
+                    ++i;
+                    continue;
+                }
+
+                --candidate;
+                size_t length = MIN_MATCH;
+                while (i + length < size && data[candidate + length] == data[i + length])
+                    ++length;
+
+                emit(out, data + anchor, i - anchor, i - candidate, length);
+                i += length;
+                anchor = i;
+            }
+
+            emit(out, data + anchor, size - anchor, 0, 0);
+        }
+
+        bool decompress(const std::string& in, char* out, size_t size) override
+        {
+            auto p = (const uint8_t*)in.data();
+            auto end = p + in.size();
+            size_t written = 0;
+
+            while (p < end)
+            {
+                auto token = *p++;
+
+                size_t literal_length = token >> 4;
+                if (!get_length(p, end, literal_length))
+                    return false;
+                if ((size_t)(end - p) < literal_length || size - written < literal_length)
+                    return false;
+
+                std::memcpy(out + written, p, literal_length);
+                p += literal_length;
+                written += literal_length;
+
+                if (p == end)
+                    break;
+
+                if (end - p < 2)
+                    return false;
+                size_t offset = p[0] | (size_t(p[1]) << 8);
+                p += 2;
+
+                size_t match = token & NIBBLE;
+                if (!get_length(p, end, match))
+                    return false;
+                match += MIN_MATCH;
+                if (offset == 0 || offset > written || size - written < match)
+                    return false;
+
+                // Byte by byte, as the match can overlap the bytes it produces.
+                for (size_t k = 0; k < match; ++k)
+                    out[written + k] = out[written + k - offset];
+                written += match;
+            }
+
+            return written == size;
+        }
+    };
+
+    /// Middle tier between resident cowns and the swap store, holding the compressed records of swapped out cowns
+    /// in memory.
+    ///
+    /// Swapping out offers each record to the tier first, and only writes the records it refuses to disk, so the
+    /// tier fills up with the coldest cowns and spills once it is full. Fetching a cown from the tier decompresses
+    /// its record without any I/O. Records that do not compress are kept as they are, but still count against the
+    /// capacity.
+    class CompressedTier
+    {
+    private:
+        struct Entry
+        {
+            std::string bytes;
+            size_t size;
+            /// Null if the record is stored uncompressed.
+            std::shared_ptr<SwapCodec> codec;
+        };
+
+        std::atomic<size_t> capacity{0};
+        /// Bytes held, or reserved by records being compressed.
+        std::atomic<size_t> used{0};
+
+        std::mutex mutex;
+        std::unordered_map<Cown*, Entry> entries;
+        std::shared_ptr<SwapCodec> codec;
+
+        bool reserve(size_t size)
+        {
+            auto current = used.load(std::memory_order_relaxed);
+            do
+            {
+                if (current + size > capacity.load(std::memory_order_relaxed))
+                    return false;
+            } while (!used.compare_exchange_weak(current, current + size, std::memory_order_relaxed));
+            return true;
+        }
+
+        void unreserve(size_t size)
+        {
+            used.fetch_sub(size, std::memory_order_relaxed);
+        }
+
+    public:
+        static CompressedTier& get()
+        {
+            static CompressedTier tier;
+            return tier;
+        }
+
+        bool is_enabled()
+        {
+            return capacity.load(std::memory_order_relaxed) > 0;
+        }
+
+        /// Sets the bytes the tier may hold, and the codec for records stored from now on. A capacity of zero
+        /// disables the tier, though records already held can still be fetched.
+        void configure(size_t bytes, std::shared_ptr<SwapCodec> new_codec)
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            codec = std::move(new_codec);
+            capacity.store(bytes, std::memory_order_relaxed);
+        }
+
+        /// Compresses `bytes`, the record of `cown`, and keeps it if there is room.
+        /// @return False if the tier is disabled or full, in which case the record belongs on disk.
+        bool put(Cown* cown, std::string&& bytes)
+        {
+            // Reserve the uncompressed size, so a full tier is detected before compressing.
+            size_t size = bytes.size();
+            if (!reserve(size))
+                return false;
+
+            Entry entry{{}, size, nullptr};
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                entry.codec = codec;
+            }
+
+            if (entry.codec != nullptr)
+                entry.codec->compress(bytes.data(), size, entry.bytes);
+
+            if (entry.codec == nullptr || entry.bytes.size() >= size)
+            {
+                entry.bytes = std::move(bytes);
+                entry.codec = nullptr;
+            }
+            unreserve(size - entry.bytes.size());
+
+            Logging::cout() << "Compressed cown " << cown << " from " << size << " to " << entry.bytes.size()
+                            << " bytes" << Logging::endl;
+
+            std::lock_guard<std::mutex> lock(mutex);
+            entries[cown] = std::move(entry);
+            return true;
+        }
+
+        /// If the cown's record is held, removes it and decompresses it into `bytes`.
+        /// @return True if the record was held.
+        bool take(Cown* cown, std::string& bytes)
+        {
+            Entry entry;
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                auto it = entries.find(cown);
+                if (it == entries.end())
+                    return false;
+
+                entry = std::move(it->second);
+                entries.erase(it);
+            }
+            unreserve(entry.bytes.size());
+
+            if (entry.codec == nullptr)
+            {
+                bytes = std::move(entry.bytes);
+                return true;
+            }
+
+            bytes.resize(entry.size);
+            if (!entry.codec->decompress(entry.bytes, bytes.data(), entry.size))
+            {
+                Logging::cout() << "Corrupt compressed record for cown " << cown << Logging::endl;
+                abort();
+            }
+            return true;
+        }
+
+        /// Removes the record of a cown that was deallocated while swapped out.
+        void discard(Cown* cown)
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            auto it = entries.find(cown);
+            if (it == entries.end())
+                return;
+
+            unreserve(it->second.bytes.size());
+            entries.erase(it);
+        }
+
+        /// Bytes held, and the bytes they decompress to. For diagnostics.
+        std::pair<size_t, size_t> debug_usage()
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            size_t held = 0;
+            size_t size = 0;
+            for (auto& [cown, entry] : entries)
+            {
+                held += entry.bytes.size();
+                size += entry.size;
+            }
+            return {held, size};
+        }
+    };
+
+} // namespace verona::rt
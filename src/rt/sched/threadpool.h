@@ -3,6 +3,8 @@
 #pragma once
 
 #include "../pal/threadpoolbuilder.h"
+#include "batchpolicy.h"
+#include "behaviourpool.h"
 #include "debug/logging.h"
 #include "threadstate.h"
 #ifdef USE_SYSTEMATIC_TESTING
@@ -12,6 +14,7 @@
 #endif
 
 #include "corepool.h"
+#include "elasticpolicy.h"
 #include "schedulerlist.h"
 
 #include <atomic>
@@ -34,9 +37,6 @@ namespace verona::rt
     friend T;
     friend void verona::rt::yield();
 
-    static constexpr uint64_t TSC_PAUSE_SLOP = 1'000'000;
-    static constexpr uint64_t TSC_UNPAUSE_SLOP = TSC_PAUSE_SLOP / 2;
-
     bool detect_leaks{true};
     size_t incarnation{1};
 
@@ -55,13 +55,40 @@ namespace verona::rt
      */
     std::atomic<uint64_t> unpause_epoch{0};
 
+    /// Most pause groups, so that one word can summarise them.
+    static constexpr size_t MAX_PAUSE_GROUPS = 64;
+
+    /**
+     * Threads pause, and are woken, in groups of cores, see
+     * `CorePool::init_pause_groups`.  Each group has its own lock and list of
+     * waiters, so threads going idle at the same time in different groups do
+     * not contend.
+     */
+    struct PauseGroup
+    {
 #ifdef USE_SYSTEMATIC_TESTING
-    ThreadSyncSystematic<T> sync;
+      ThreadSyncSystematic<T> sync;
 #else
-    ThreadSync<T> sync;
+      ThreadSync<T> sync;
 #endif
+      /// Threads asleep in `pause` in this group.  Changed under its lock.
+      size_t parked = 0;
+    };
 
-    uint64_t barrier_incarnation = 0;
+    PauseGroup pause_groups[MAX_PAUSE_GROUPS];
+
+    /**
+     * Bit `i` is set while pause group `i` has threads asleep in `pause`.
+     * While this is non-zero, `unpause` wakes one of them, so a burst of work
+     * wakes threads one at a time as it is scheduled, rather than all of them
+     * at once or none.
+     */
+    std::atomic<uint64_t> parked_groups{0};
+
+    /// Most cores in a pause group, used by the next `init`.
+    size_t pause_group_cores = 16;
+
+    std::atomic<uint64_t> barrier_incarnation = 0;
 
     /// List of instantiated scheduler threads.
     /// Contains both free and active threads; protects accesses with a lock.
@@ -71,13 +98,47 @@ namespace verona::rt
     size_t thread_count = 0;
 
     /// Count of external event sources, such as I/O, that will prevent
-    /// quiescence.
-    size_t external_event_sources = 0;
+    /// quiescence.  Changed under the lock of the caller's pause group.
+    std::atomic<size_t> external_event_sources = 0;
 
     bool teardown_in_progress = false;
 
     bool fair = false;
 
+    /// Whether ready behaviours are routed back to the core that last ran
+    /// their first cown.
+    bool affinity = false;
+
+    /// Most work items taken from another core by one steal.
+    size_t steal_batch = 32;
+
+    /// Most behaviours a thread runs back to back on one cown, see
+    /// `coalesce`.
+    size_t coalesce_budget = 16;
+
+    /// How threads size their batches of local work, and the size used by
+    /// `BatchPolicy::Fixed`, or the starting size for `Adaptive`.
+    BatchPolicy batch_policy = BatchPolicy::Fixed;
+    size_t batch_size = 100;
+
+    /// Cores being serviced, from the first core in ring order.  The rest are
+    /// retired.  Changed under `elastic_lock`, but read without it.
+    std::atomic<size_t> active_cores{0};
+    snmalloc::FlagWord elastic_lock;
+
+    /// How, and within which bounds, `active_cores` changes automatically.
+    /// Can be changed while the scheduler threads read them, which may then
+    /// make one decision with a mix of the old and new bounds.
+    std::atomic<ElasticPolicy> elastic_policy{ElasticPolicy::Fixed};
+    std::atomic<size_t> elastic_min{1};
+    std::atomic<size_t> elastic_max{SIZE_MAX};
+    ElasticClock elastic_clock;
+
+    /// Ticks a thread out of work spins, then yields its CPU, looking for
+    /// work before it parks.
+    uint64_t spin_ticks = 1'000'000;
+    uint64_t yield_ticks = 0;
+
     ThreadState state;
 
     /// Pool of cores shared by the scheduler threads.
@@ -116,8 +177,9 @@ namespace verona::rt
     static void add_external_event_source()
     {
       auto& s = get();
-      auto h = s.sync.handle(local());
-      assert(local() != nullptr);
+      auto* t = local();
+      assert(t != nullptr);
+      auto h = s.pause_group(t).sync.handle(t);
       auto prev_count = s.external_event_sources++;
       Logging::cout() << "Add external event source (now " << (prev_count + 1)
                       << ")" << Logging::endl;
@@ -139,10 +201,11 @@ namespace verona::rt
       // Forcing this code to be injected onto a scheduler thread by a message
       // means the runtime cannot be attempting to pause while this code is
       // running.
-      assert(local() != nullptr);
+      auto* t = local();
+      assert(t != nullptr);
 
       auto& s = get();
-      auto h = s.sync.handle(local());
+      auto h = s.pause_group(t).sync.handle(t);
       auto prev_count = s.external_event_sources--;
       assert(prev_count != 0);
       Logging::cout() << "Remove external event source (now "
@@ -156,6 +219,161 @@ namespace verona::rt
       s.fair = fair;
     }
 
+    /// Set whether ready behaviours are routed back to the core that last ran
+    /// their first cown, so its data is still in that core's caches, unless
+    /// that core is overloaded.
+    static void set_affinity(bool affinity)
+    {
+      Logging::cout() << "Set affinity: " << affinity << Logging::endl;
+      get().affinity = affinity;
+    }
+
+    static bool get_affinity()
+    {
+      return get().affinity;
+    }
+
+    /// Set the most work items an idle thread takes from another core at
+    /// once. It takes at most half of the work it observes, and with a batch
+    /// of 1 it steals a single item at a time.
+    static void set_steal_batch(size_t batch)
+    {
+      Logging::cout() << "Set steal batch: " << batch << Logging::endl;
+      get().steal_batch = batch == 0 ? 1 : batch;
+    }
+
+    static size_t get_steal_batch()
+    {
+      return get().steal_batch;
+    }
+
+    /// Set how many behaviours that each only need the cown the previous one
+    /// has just released a thread runs straight after one another, before
+    /// going back to its queues.  These count towards the thread's batch, see
+    /// `set_batch_policy`.  0 turns this off.
+    static void set_coalesce_budget(size_t budget)
+    {
+      Logging::cout() << "Set coalesce budget: " << budget << Logging::endl;
+      get().coalesce_budget = budget;
+    }
+
+    static size_t get_coalesce_budget()
+    {
+      return get().coalesce_budget;
+    }
+
+    /// Set how many work items a thread runs from its own recently scheduled
+    /// work before checking its core's queue. Takes effect from each thread's
+    /// next batch.
+    static void set_batch_policy(BatchPolicy policy, size_t batch = 100)
+    {
+      Logging::cout() << "Set batch policy: " << (int)policy << " " << batch
+                      << Logging::endl;
+      auto& s = get();
+      s.batch_policy = policy;
+      s.batch_size = batch == 0 ? 1 : batch;
+    }
+
+    static BatchPolicy get_batch_policy()
+    {
+      return get().batch_policy;
+    }
+
+    static size_t get_batch_size()
+    {
+      return get().batch_size;
+    }
+
+    /// Set how long a thread that has run out of work keeps looking for it
+    /// before parking: first spinning for `spin` ticks, then yielding its CPU
+    /// to other threads for a further `yield` ticks. Shorter times save CPU
+    /// under bursty load, longer ones avoid the cost of waking up.
+    static void set_park_thresholds(uint64_t spin, uint64_t yield = 0)
+    {
+      Logging::cout() << "Set park thresholds: " << spin << " " << yield
+                      << Logging::endl;
+      auto& s = get();
+      s.spin_ticks = spin;
+      s.yield_ticks = yield;
+    }
+
+    static uint64_t get_spin_ticks()
+    {
+      return get().spin_ticks;
+    }
+
+    static uint64_t get_yield_ticks()
+    {
+      return get().yield_ticks;
+    }
+
+    /**
+     * Service only the first `count` cores, in ring order, from the
+     * `thread_count` given to `init`.  Can be called while the runtime runs.
+     * The threads of retired cores park at their next batch boundary, or when
+     * they run out of work, and their queued work is stolen by the other
+     * cores.  Growing wakes the threads of restored cores.
+     */
+    static void set_active_cores(size_t count)
+    {
+      auto& s = get();
+      {
+        FlagLock f(s.elastic_lock);
+
+        count = std::clamp<size_t>(count, 1, s.thread_count);
+        if (count == s.active_cores.load(std::memory_order_relaxed))
+          return;
+
+        Logging::cout() << "Set active cores: " << count << Logging::endl;
+
+        Core* c = first_core();
+        for (size_t i = 0; i < s.thread_count; i++)
+        {
+          c->retired.store(i >= count, std::memory_order_relaxed);
+          c = c->next;
+        }
+        s.active_cores.store(count, std::memory_order_relaxed);
+      }
+
+      s.unpause_all_groups();
+    }
+
+    static size_t get_active_cores()
+    {
+      return get().active_cores.load(std::memory_order_relaxed);
+    }
+
+    /**
+     * Set whether the number of active cores follows the load, between `min`
+     * and `max`, see `ElasticPolicy`.
+     */
+    static void set_elastic_policy(
+      ElasticPolicy policy, size_t min = 1, size_t max = SIZE_MAX)
+    {
+      Logging::cout() << "Set elastic policy: " << (int)policy << " " << min
+                      << " " << max << Logging::endl;
+      auto& s = get();
+      min = std::max<size_t>(min, 1);
+      s.elastic_min.store(min, std::memory_order_relaxed);
+      s.elastic_max.store(std::max(max, min), std::memory_order_relaxed);
+      s.elastic_policy.store(policy, std::memory_order_relaxed);
+    }
+
+    static ElasticPolicy get_elastic_policy()
+    {
+      return get().elastic_policy.load(std::memory_order_relaxed);
+    }
+
+    /**
+     * Set the most cores in a group of cores whose threads pause and are woken
+     * separately from other groups.  Groups never span NUMA nodes.  Takes
+     * effect from the next `init`.
+     */
+    static void set_pause_group_cores(size_t cores)
+    {
+      get().pause_group_cores = std::max<size_t>(cores, 1);
+    }
+
     static bool is_teardown_in_progress()
     {
       return get().teardown_in_progress;
@@ -182,21 +400,65 @@ namespace verona::rt
         nonlocal = nonlocal->next;
       }
 
+      // Skip retired cores.  The first core is never retired.
+      while (nonlocal->retired.load(std::memory_order_relaxed))
+        nonlocal = nonlocal->next;
+
       return nonlocal;
     }
 
-    static void schedule(Work* w)
+    static void schedule(Work* w, Priority priority = Priority::Normal)
     {
       auto* t = local();
 
       if (t != nullptr)
       {
-        t->schedule_fifo(w);
+        t->schedule_fifo(w, priority);
         return;
       }
 
       auto* core = round_robin();
-      T::schedule_lifo(core, w);
+      T::schedule_lifo(core, w, priority);
+    }
+
+    /**
+     * Schedule `w` at normal priority, to run by `deadline`, an absolute
+     * `Aal::tick()` value.  Each core takes its deadline work earliest
+     * deadline first, in turn with its other normal priority work, and idle
+     * cores steal the work nearest its deadline first.
+     */
+    static void schedule_deadline(Work* w, uint64_t deadline)
+    {
+      auto* t = local();
+      auto* core = t != nullptr ? t->core : round_robin();
+      T::schedule_deadline(core, w, deadline);
+    }
+
+    /**
+     * Schedule `w` on `home`, the core that last ran its data, unless that
+     * core is overloaded, in which case it is scheduled as usual.
+     */
+    static void schedule_affine(Work* w, Priority priority, Core* home)
+    {
+      auto* t = local();
+
+      if (t == nullptr || home == nullptr)
+      {
+        schedule(w, priority);
+        return;
+      }
+
+      t->schedule_affine(home, w, priority);
+    }
+
+    /**
+     * The core of the calling scheduler thread, or nullptr if called from
+     * another thread.
+     */
+    static Core* local_core()
+    {
+      auto* t = local();
+      return t != nullptr ? t->core : nullptr;
     }
 
     void init(size_t count)
@@ -207,10 +469,11 @@ namespace verona::rt
         abort();
 
       thread_count = count;
+      active_cores.store(count, std::memory_order_relaxed);
       teardown_in_progress = false;
 
       // Initialize the corepool.
-      core_pool.init(count);
+      core_pool.init(count, pause_group_cores, MAX_PAUSE_GROUPS);
 
       // For future ids.
       systematic_ids = count + 1;
@@ -263,10 +526,12 @@ namespace verona::rt
       Object::reset_ids();
 #endif
       thread_count = 0;
+      active_cores.store(0, std::memory_order_relaxed);
       // Flush any cowns that weren't collected due to potential
       // ABA issues on the queue.  The runtime is in a consistent
       // state so no ABAs can exist anymore.
       Epoch::flush(ThreadAlloc::get());
+      BehaviourPool::flush_depot();
 
       core_pool.clear();
 
@@ -279,6 +544,27 @@ namespace verona::rt
     }
 
   private:
+    PauseGroup& pause_group(T* t)
+    {
+      return pause_groups[t->core->pause_group];
+    }
+
+    /// Wake every thread paused in every group.  Must not be called while
+    /// holding the handle of a group.
+    void unpause_all_groups()
+    {
+      for (size_t i = 0; i < core_pool.pause_group_count; i++)
+        pause_groups[i].sync.unpause_all(local());
+    }
+
+    /// Record that a thread counted in `parked` of `group` is no longer
+    /// parked.  Called under the group's lock.
+    void unpark(PauseGroup& group, uint64_t group_bit)
+    {
+      if (--group.parked == 0)
+        parked_groups.fetch_and(~group_bit, std::memory_order_relaxed);
+    }
+
     bool check_for_work()
     {
       // TODO: check for pending async IO
@@ -287,7 +573,7 @@ namespace verona::rt
       {
         Logging::cout() << "Checking for pending work on thread " << c->affinity
                         << Logging::endl;
-        if (!c->q.nothing_old())
+        if (!c->nothing_old())
         {
           Logging::cout() << "Found pending work!" << Logging::endl;
           return true;
@@ -301,6 +587,10 @@ namespace verona::rt
 
     bool pause()
     {
+      auto* t = local();
+      auto& group = pause_group(t);
+      uint64_t group_bit = (uint64_t)1 << t->core->pause_group;
+
       // Snapshot unpause_epoch, so we can detect a racing unpause.
       auto local_unpause_epoch = unpause_epoch.load(std::memory_order_relaxed);
 
@@ -320,34 +610,52 @@ namespace verona::rt
       yield();
 
       {
-        auto h = sync.handle(local());
+        auto h = group.sync.handle(t);
+
+        // Publish that this group has a parked thread before checking for a
+        // racing unpause.  `unpause_slow` moves unpause_epoch on before it
+        // reads `parked_groups`, so either it finds this group, or this
+        // thread sees the unpause.
+        if (group.parked++ == 0)
+          parked_groups.fetch_or(group_bit, std::memory_order_seq_cst);
 
         // An unpause has occurred since, we started to pause.
         if (
-          local_unpause_epoch != unpause_epoch.load(std::memory_order_relaxed))
+          local_unpause_epoch != unpause_epoch.load(std::memory_order_seq_cst))
+        {
+          unpark(group, group_bit);
           return false;
+        }
 
         // Check if we should wait for other threads to generate more work.
-        auto value = state.get_active_threads();
-        if (value > 1)
+        // The other groups' threads pause concurrently, so the check and
+        // decrement are one atomic step, leaving exactly one last thread.
+        if (state.try_dec_active_threads())
         {
-          state.dec_active_threads();
           Logging::cout() << "Pausing" << Logging::endl;
           h.pause(); // Spurious wake-ups are safe.
+          unpark(group, group_bit);
           Logging::cout() << "Unpausing" << Logging::endl;
           state.inc_active_threads();
           return true;
         }
 
         // There are external sources should wait for external wake ups.
+        // This thread stops counting as active too, as the wake up may go to
+        // another thread, which must then be able to tear down.
         if (external_event_sources != 0)
         {
+          state.dec_active_threads();
           Logging::cout() << "Pausing last thread" << Logging::endl;
           h.pause(); // Spurious wake-ups are safe.
+          unpark(group, group_bit);
           Logging::cout() << "Unpausing last thread" << Logging::endl;
+          state.inc_active_threads();
           return true;
         }
 
+        unpark(group, group_bit);
+
         Logging::cout() << "Teardown beginning" << Logging::endl;
         // Used to handle deallocating all the state of the threads.
         teardown_in_progress = true;
@@ -355,17 +663,94 @@ namespace verona::rt
         // Tell all threads to stop looking for work.
         threads.forall([](T* thread) { thread->stop(); });
         Logging::cout() << "Teardown: all threads stopped" << Logging::endl;
-
-        h.unpause_all();
-        Logging::cout() << "cv_notify_all() for teardown" << Logging::endl;
       }
+
+      // Every other thread has stopped counting as active, so is parked, or
+      // is about to park while holding its group's lock, which then wakes it.
+      unpause_all_groups();
+      Logging::cout() << "cv_notify_all() for teardown" << Logging::endl;
       Logging::cout() << "Teardown: all threads beginning teardown"
                       << Logging::endl;
       return true;
     }
 
+    /**
+     * Park the calling thread, as its core has been retired, until the core
+     * is restored or the runtime tears down.  The last active thread does not
+     * park, as it must keep running the work.
+     * @return true if the thread parked.
+     */
+    bool retire()
+    {
+      auto* t = local();
+
+      // This thread will no longer look for work, so hand any that is queued,
+      // including on this core, to another thread.
+      if (check_for_work())
+        wake_one(nullptr);
+
+      yield();
+
+      auto h = pause_group(t).sync.handle(t);
+      if (!state.try_dec_active_threads())
+        return false;
+
+      threads.move_active_to_free(t);
+      Logging::cout() << "Retiring" << Logging::endl;
+
+      while (t->core->retired.load(std::memory_order_relaxed) && t->running)
+        h.pause(true);
+
+      Logging::cout() << "Restored" << Logging::endl;
+      threads.move_free_to_active(t);
+      state.inc_active_threads();
+      return true;
+    }
+
+    /**
+     * Under `ElasticPolicy::Auto`, grow or shrink the active cores by one if
+     * the load calls for it and a decision is due.  `idle` is set if the
+     * caller has run out of work.
+     */
+    void elastic_check(bool idle)
+    {
+      if (
+        elastic_policy.load(std::memory_order_relaxed) != ElasticPolicy::Auto ||
+        !elastic_clock.due())
+        return;
+
+      auto active = active_cores.load(std::memory_order_relaxed);
+      if (idle)
+      {
+        // Another thread is already parked without work, so there are more
+        // threads than work.
+        if (
+          parked_groups.load(std::memory_order_relaxed) != 0 &&
+          active > elastic_min.load(std::memory_order_relaxed))
+          set_active_cores(active - 1);
+        return;
+      }
+
+      if (
+        active >= elastic_max.load(std::memory_order_relaxed) ||
+        parked_groups.load(std::memory_order_relaxed) != 0)
+        return;
+
+      // Every active core has work waiting, so another thread would have work
+      // to take.
+      Core* c = first_core();
+      for (size_t i = 0; i < active; i++)
+      {
+        if (c->nothing_old())
+          return;
+        c = c->next;
+      }
+
+      set_active_cores(active + 1);
+    }
+
     SNMALLOC_SLOW_PATH
-    bool unpause_slow()
+    bool unpause_slow(Core* target)
     {
       auto local_unpause_epoch = unpause_epoch.load(std::memory_order_acquire);
 
@@ -378,26 +763,65 @@ namespace verona::rt
 
       yield();
 
-      // Attempt to catch up epoch.
-      bool success = unpause_epoch.compare_exchange_strong(
-        local_unpause_epoch, local_pause_epoch);
+      if (local_unpause_epoch != local_pause_epoch)
+      {
+        // Attempt to catch up epoch, so threads part way through pausing see
+        // the unpause and do not sleep.
+        bool success = unpause_epoch.compare_exchange_strong(
+          local_unpause_epoch, local_pause_epoch);
 
-      yield();
+        yield();
+
+        // Another thread won the CAS race, and is responsible for waking up.
+        if (!success)
+          return false;
+      }
+
+      // Only one thread is needed for the new work; any others still parked
+      // are woken by later calls, as more work arrives.
+      Logging::cout() << "Wake one thread" << Logging::endl;
+      wake_one(target);
+      return true;
+    }
+
+    /**
+     * Wake a thread parked in `pause`, preferring one servicing `target`.
+     * Tries the group of `target`, or of this thread's core, first, then the
+     * other groups with parked threads.  Each try grabs the group's lock to
+     * ensure its threads have seen the CAS of unpause_epoch before we notify.
+     */
+    void wake_one(Core* target)
+    {
+      auto* t = local();
+      Core* nearest = target;
+      if (nearest == nullptr && t != nullptr)
+        nearest = t->core;
 
-      if (success)
+      auto groups = parked_groups.load(std::memory_order_seq_cst);
+      if (nearest != nullptr)
       {
-        // This grabs the scheduler lock to ensure threads have seen CAS before
-        // we notify.
-        Logging::cout() << "Wake all threads" << Logging::endl;
-        sync.unpause_all(local());
-        return true;
+        uint64_t first_bit = (uint64_t)1 << nearest->pause_group;
+        if (
+          ((groups & first_bit) != 0) &&
+          pause_groups[nearest->pause_group].sync.unpause_one(t, target))
+          return;
+        groups &= ~first_bit;
+      }
+
+      while (groups != 0)
+      {
+        if (pause_groups[bits::ctz(groups)].sync.unpause_one(t, target))
+          return;
+        groups &= groups - 1;
       }
-      // Another thread won the CAS race, and is responsible for waking up.
-      return false;
     }
 
+    /**
+     * Called after adding work.  Wakes a parked thread, preferring one
+     * servicing `target`, the core the work was added to.
+     */
     SNMALLOC_FAST_PATH
-    bool unpause()
+    bool unpause(Core* target = nullptr)
     {
       Logging::cout() << "unpause()" << Logging::endl;
       // Adding work using seq_cst so will be visible
@@ -411,10 +835,12 @@ namespace verona::rt
 
       // Exit early if we think no threads are trying to sleep.
       // Our work will be visible to any thread at this point.
-      if (SNMALLOC_LIKELY(local_unpause_epoch == local_pause_epoch))
+      if (SNMALLOC_LIKELY(
+            local_unpause_epoch == local_pause_epoch &&
+            parked_groups.load(std::memory_order_relaxed) == 0))
         return false;
 
-      return unpause_slow();
+      return unpause_slow(target);
     }
 
     void init_barrier()
@@ -424,9 +850,10 @@ namespace verona::rt
 
     void enter_barrier()
     {
-      auto inc = barrier_incarnation;
+      auto* t = local();
+      auto inc = barrier_incarnation.load();
       {
-        auto h = sync.handle(local());
+        auto h = pause_group(t).sync.handle(t);
         auto barrier_count = state.exit_thread();
         if (barrier_count != 0)
         {
@@ -438,11 +865,35 @@ namespace verona::rt
         }
         init_barrier();
         barrier_incarnation++;
-        h.unpause_all();
       }
+      unpause_all_groups();
     }
 
   public:
+    /**
+     * Run `w` on this thread as soon as the current work item finishes,
+     * without going through any queue.  Returns false if `w` must be
+     * scheduled as usual, because this is not a scheduler thread, another
+     * work item is already waiting, or the thread's budget is used up.
+     */
+    static bool coalesce(Work* w)
+    {
+      auto* l = local();
+      return l != nullptr && l->coalesce(w);
+    }
+
+    /**
+     * The pool of behaviour memory of this thread, or nullptr if this is not
+     * a scheduler thread.
+     */
+    static BehaviourPool* behaviour_pool()
+    {
+      auto* l = local();
+      if (l != nullptr)
+        return &l->behaviour_pool;
+      return nullptr;
+    }
+
     static SchedulerStats& stats()
     {
       auto* l = local();
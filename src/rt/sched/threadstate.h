@@ -13,7 +13,9 @@ namespace verona::rt
     // ThreadState counters.
     struct StateCounters
     {
-      size_t active_threads{0};
+      /// Changed under the lock of a pause group, which need not be the same
+      /// group for every change, so atomic.
+      std::atomic<size_t> active_threads{0};
       std::atomic<size_t> barrier_count{0};
 
       constexpr StateCounters() = default;
@@ -47,6 +49,23 @@ namespace verona::rt
       internal_state.active_threads--;
     }
 
+    /**
+     * Decrement the active threads, unless only one is active, as the last
+     * active thread must stay active to decide whether to tear down.
+     * @return true if decremented.
+     */
+    bool try_dec_active_threads()
+    {
+      auto& active = internal_state.active_threads;
+      auto value = active.load();
+      while (value > 1)
+      {
+        if (active.compare_exchange_weak(value, value - 1))
+          return true;
+      }
+      return false;
+    }
+
     void inc_active_threads()
     {
       internal_state.active_threads++;
@@ -15,6 +15,8 @@
  */
 namespace verona::rt
 {
+  class Core;
+
   /**
    * This class is a custom spin lock for handling thread pausing and unpausing.
    *
@@ -60,6 +62,15 @@ namespace verona::rt
       Logging::cout() << "Locking Scheduler done" << Logging::endl;
     }
 
+    /**
+     * Acquires the lock if it is available, without spinning.
+     */
+    bool try_lock()
+    {
+      auto u = Unlocked;
+      return state.compare_exchange_strong(u, Locked);
+    }
+
     /**
      * Attempts to release the lock.  If the lock has received an unpause
      * request, then will return false, and continues to hold the lock.
@@ -96,6 +107,11 @@ namespace verona::rt
   {
     pal::SleepHandle sem;
     LocalSync* next{nullptr};
+    /// Core the sleeping thread services, to target wake ups.
+    Core* core{nullptr};
+    /// Set if the thread is parked as its core is retired, so is only woken
+    /// by `unpause_all`.
+    bool retired{false};
   };
 
   template<class T>
@@ -139,6 +155,55 @@ namespace verona::rt
       Logging::cout() << "Unpause all done" << Logging::endl;
     }
 
+    /**
+     * Wake a single waiter, preferring one servicing `target`.  If the lock
+     * is busy this falls back to asking its holder to wake all the waiters,
+     * rather than spinning on it.
+     * @return false if there was no waiter to wake.
+     */
+    bool unpause_one(T* me, Core* target)
+    {
+      if (!lock.try_lock())
+      {
+        unpause_all(me);
+        return true;
+      }
+
+      // The first waiter servicing `target`, or failing that the most recent,
+      // ignoring retired threads.
+      LocalSync** prev = nullptr;
+      for (auto p = &waiters; *p != nullptr; p = &(*p)->next)
+      {
+        if ((*p)->retired)
+          continue;
+
+        if (prev == nullptr)
+          prev = p;
+
+        if ((*p)->core == target)
+        {
+          prev = p;
+          break;
+        }
+      }
+
+      LocalSync* woken = nullptr;
+      if (prev != nullptr)
+      {
+        woken = *prev;
+        *prev = woken->next;
+      }
+
+      unlock();
+
+      if (woken == nullptr)
+        return false;
+
+      Logging::cout() << "Unpause one" << Logging::endl;
+      woken->sem.wake();
+      return true;
+    }
+
     class ThreadSyncHandle
     {
       T* thread;
@@ -160,11 +225,14 @@ namespace verona::rt
        * Pause this thread
        *
        * If this is the last thread, then something external must call
-       * unpause_all to restart the paused threads.
+       * unpause_all to restart the paused threads.  A `retired` thread is
+       * only woken by unpause_all.
        */
-      void pause()
+      void pause(bool retired = false)
       {
         Logging::cout() << "Add to list of waiters" << Logging::endl;
+        thread->local_sync.core = thread->core;
+        thread->local_sync.retired = retired;
         thread->local_sync.next = sync.waiters;
         sync.waiters = &(thread->local_sync);
         sync.unlock();
@@ -16,12 +16,27 @@
  */
 namespace verona::rt
 {
+  class Core;
+
   template<typename T>
   class ThreadSyncSystematic
   {
+    /// A paused thread, which can be woken individually.
+    struct Waiter
+    {
+      Core* core;
+      /// Only woken by unpause_all.
+      bool retired = false;
+      bool woken = false;
+      Waiter* next = nullptr;
+    };
+
     /// Model underlying locking provided by the handle.
     bool m = false;
 
+    /// Paused threads not yet woken, most recent first.
+    Waiter* waiters = nullptr;
+
     /// unpause incarnation
     /// Complete wrap around will lead to lost wake-up.  This seems safe to
     /// ignore.
@@ -37,6 +52,7 @@ namespace verona::rt
   public:
     class ThreadSyncHandle
     {
+      T* thread;
       ThreadSyncSystematic& sync;
       bool wake_on_exit = false;
 
@@ -52,18 +68,24 @@ namespace verona::rt
       }
 
       /**
-       * Pause this thread
+       * Pause this thread.  A `retired` thread is only woken by unpause_all.
        */
-      void pause()
+      void pause(bool retired = false)
       {
         assert(sync.m == true);
         sync.m = false;
 
+        Waiter waiter{thread == nullptr ? nullptr : thread->core, retired};
+        waiter.next = sync.waiters;
+        sync.waiters = &waiter;
+
         auto incarnation = sync.unpause_incarnation;
         // Copy for capture by value
         auto sync_ptr = &sync;
-        auto guard = [incarnation, sync_ptr]() {
-          return incarnation != sync_ptr->unpause_incarnation;
+        auto waiter_ptr = &waiter;
+        auto guard = [incarnation, sync_ptr, waiter_ptr]() {
+          return waiter_ptr->woken ||
+            incarnation != sync_ptr->unpause_incarnation;
         };
         // Guard should not hold here.
         assert(!guard());
@@ -72,7 +94,9 @@ namespace verona::rt
         sync.acquire();
       }
 
-      ThreadSyncHandle(ThreadSyncSystematic& sync) : sync(sync) {}
+      ThreadSyncHandle(T* thread, ThreadSyncSystematic& sync)
+      : thread(thread), sync(sync)
+      {}
 
       ~ThreadSyncHandle()
       {
@@ -84,6 +108,7 @@ namespace verona::rt
           // Treat as a yield pointer if thread is under systematic testing
           // control.
           sync.unpause_incarnation++;
+          sync.waiters = nullptr;
           Systematic::yield();
         }
       }
@@ -97,9 +122,8 @@ namespace verona::rt
      */
     ThreadSyncHandle handle(T* me)
     {
-      UNUSED(me);
       acquire();
-      return ThreadSyncHandle(*this);
+      return ThreadSyncHandle(me, *this);
     }
 
     /**
@@ -109,5 +133,37 @@ namespace verona::rt
     {
       handle(me).unpause_all();
     }
+
+    /**
+     * This unpauses a single thread, preferring one servicing `target`, and
+     * never a retired one.  Returns false if there was none to unpause.
+     */
+    bool unpause_one(T* me, Core* target)
+    {
+      auto h = handle(me);
+
+      Waiter** prev = nullptr;
+      for (auto p = &waiters; *p != nullptr; p = &(*p)->next)
+      {
+        if ((*p)->retired)
+          continue;
+
+        if (prev == nullptr)
+          prev = p;
+
+        if ((*p)->core == target)
+        {
+          prev = p;
+          break;
+        }
+      }
+
+      if (prev == nullptr)
+        return false;
+
+      (*prev)->woken = true;
+      *prev = (*prev)->next;
+      return true;
+    }
   };
 }
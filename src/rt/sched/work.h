@@ -11,6 +11,28 @@ namespace verona::rt
 {
   using namespace snmalloc;
 
+  /**
+   * How urgently a work item should run.  Each core has a queue per priority,
+   * and takes from the highest priority queue with work, but each time a
+   * queue's token comes round the next lower priority queue gets a turn, so
+   * lower priority work is delayed but never starved.
+   */
+  enum class Priority : uint8_t
+  {
+    /// Background work, such as batch jobs.
+    Low,
+    Normal,
+    /// Latency critical work, such as request handlers.
+    High,
+  };
+
+  /**
+   * Deadline of work that has none.  Deadlines are absolute, in
+   * `snmalloc::Aal::tick()` units.
+   */
+  static constexpr uint64_t NO_DEADLINE =
+    (std::numeric_limits<uint64_t>::max)();
+
   /**
    * @brief A work item that can be scheduled.
    *
@@ -44,6 +66,16 @@ namespace verona::rt
       f(this);
     }
 
+    /**
+     * Whether the memory of this work item can be reused straight away, as
+     * no queue can still refer to it.  See `dealloc`.
+     */
+    bool is_reusable()
+    {
+      auto epoch = epoch_when_popped;
+      return epoch == NO_EPOCH_SET || GlobalEpoch::is_outdated(epoch);
+    }
+
     /**
      * Helper to perform deallocation.
      *
@@ -58,9 +90,7 @@ namespace verona::rt
     void dealloc()
     {
       auto& alloc = ThreadAlloc::get();
-      auto epoch = epoch_when_popped;
-      auto outdated = epoch == NO_EPOCH_SET || GlobalEpoch::is_outdated(epoch);
-      if (outdated)
+      if (is_reusable())
       {
         Logging::cout() << "Work " << this << " dealloc" << Logging::endl;
         alloc.dealloc(this);
@@ -0,0 +1,113 @@
+// Copyright Microsoft and Project Verona Contributors.
+// SPDX-License-Identifier: MIT
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+namespace verona::rt
+{
+  /**
+   * Fixed capacity work stealing deque, after Chase and Lev, using the C11
+   * formulation of Lê et al.
+   *
+   * One owner thread pushes and pops at the bottom, in LIFO order, with plain
+   * loads and stores and a fence; it only needs a compare and swap when
+   * racing thieves for the last element.  Any number of thieves take from
+   * the top, the oldest element, with a compare and swap.
+   *
+   * Elements are never dereferenced, so unlike `MPMCQ` no epoch is needed
+   * for memory safety.  The indexes only increase, so there is no ABA.
+   * Pushing to a full deque fails, and the owner should fall back to a
+   * shared queue.
+   */
+  template<class T, size_t N = 256>
+  class WorkDeque
+  {
+    static_assert((N & (N - 1)) == 0, "Capacity must be a power of two");
+
+  private:
+    std::atomic<int64_t> top{0};
+    std::atomic<int64_t> bottom{0};
+    std::atomic<T*> buffer[N]{};
+
+  public:
+    /**
+     * Add an element at the bottom.  Owner only.
+     * @return false if the deque is full.
+     */
+    bool push(T* item)
+    {
+      auto b = bottom.load(std::memory_order_relaxed);
+      auto t = top.load(std::memory_order_acquire);
+      if (b - t >= (int64_t)N)
+        return false;
+
+      buffer[b & (N - 1)].store(item, std::memory_order_relaxed);
+      std::atomic_thread_fence(std::memory_order_release);
+      bottom.store(b + 1, std::memory_order_relaxed);
+      return true;
+    }
+
+    /**
+     * Take the most recently pushed element.  Owner only.
+     */
+    T* pop()
+    {
+      auto b = bottom.load(std::memory_order_relaxed) - 1;
+      bottom.store(b, std::memory_order_relaxed);
+      std::atomic_thread_fence(std::memory_order_seq_cst);
+      auto t = top.load(std::memory_order_relaxed);
+
+      if (t > b)
+      {
+        // Empty.
+        bottom.store(b + 1, std::memory_order_relaxed);
+        return nullptr;
+      }
+
+      T* item = buffer[b & (N - 1)].load(std::memory_order_relaxed);
+      if (t == b)
+      {
+        // Last element, so race any thieves for it.
+        if (!top.compare_exchange_strong(
+              t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+          item = nullptr;
+        bottom.store(b + 1, std::memory_order_relaxed);
+      }
+      return item;
+    }
+
+    /**
+     * Take the oldest element.  Can be called from any thread.  May
+     * spuriously fail when racing other thieves or the owner.
+     */
+    T* steal()
+    {
+      auto t = top.load(std::memory_order_acquire);
+      std::atomic_thread_fence(std::memory_order_seq_cst);
+      auto b = bottom.load(std::memory_order_acquire);
+
+      if (t >= b)
+        return nullptr;
+
+      T* item = buffer[t & (N - 1)].load(std::memory_order_relaxed);
+      if (!top.compare_exchange_strong(
+            t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+        return nullptr;
+
+      return item;
+    }
+
+    /**
+     * Approximately whether the deque is empty.  Exact when called by the
+     * owner with no thieves running.
+     */
+    bool empty()
+    {
+      return top.load(std::memory_order_relaxed) >=
+        bottom.load(std::memory_order_relaxed);
+    }
+  };
+} // namespace verona::rt
@@ -0,0 +1,76 @@
+// Copyright Microsoft and Project Verona Contributors.
+// SPDX-License-Identifier: MIT
+
+#include <cpp/when.h>
+#include <debug/harness.h>
+
+using namespace verona::cpp;
+
+struct Account
+{
+  int64_t balance = 100;
+};
+
+static constexpr size_t ACCOUNTS = 8;
+static constexpr size_t TRANSFERS = 200;
+
+static std::atomic<size_t> transfers;
+
+/**
+ * Transfers between accounts, which are routed between cores by the accounts
+ * they last ran on, all run, and money is neither lost nor created.
+ */
+void test_transfers()
+{
+  transfers = 0;
+  size_t expected = 0;
+
+  std::vector<cown_ptr<Account>> accounts;
+  for (size_t i = 0; i < ACCOUNTS; i++)
+  {
+    accounts.push_back(make_cown<Account>());
+
+    // Spread the accounts' homes across the cores.
+    when(accounts.back()) << [](auto) {};
+  }
+
+  for (size_t i = 0; i < TRANSFERS; i++)
+  {
+    auto from = i % ACCOUNTS;
+    auto to = ((i * 3) + 1) % ACCOUNTS;
+    if (from == to)
+      continue;
+
+    expected++;
+    when(accounts[from], accounts[to]) << [](auto from, auto to) {
+      from->balance -= 10;
+      to->balance += 10;
+      transfers++;
+    };
+  }
+
+  // Runs after every transfer, as it needs all the accounts.
+  when(
+    accounts[0],
+    accounts[1],
+    accounts[2],
+    accounts[3],
+    accounts[4],
+    accounts[5],
+    accounts[6],
+    accounts[7]) << [expected](auto... as) {
+    check(transfers == expected);
+    check((as->balance + ...) == (int64_t)(100 * ACCOUNTS));
+  };
+}
+
+int main(int argc, char** argv)
+{
+  SystematicTestHarness harness(argc, argv);
+
+  Scheduler::set_affinity(true);
+
+  harness.run(test_transfers);
+
+  return 0;
+}
@@ -0,0 +1,103 @@
+// Copyright Microsoft and Project Verona Contributors.
+// SPDX-License-Identifier: MIT
+
+#include <cpp/when.h>
+#include <debug/harness.h>
+#include <vector>
+
+using namespace verona::cpp;
+
+struct Log
+{
+  std::vector<size_t> entries;
+};
+
+static constexpr size_t COWNS = 4;
+static constexpr size_t ENTRIES = 40;
+
+static std::atomic<size_t> checked{0};
+
+/**
+ * Queues behaviours on each cown, which are run back to back where the
+ * budget allows.  Writers on one cown are mixed with writers on two, readers,
+ * and a high priority writer, none of which may be coalesced, and every cown
+ * must still see its writers in the order they were queued.
+ */
+void test_order()
+{
+  std::vector<cown_ptr<Log>> logs;
+  for (size_t i = 0; i < COWNS; i++)
+    logs.push_back(make_cown<Log>());
+
+  when() << [logs]() {
+    for (size_t i = 0; i < ENTRIES; i++)
+    {
+      for (size_t j = 0; j < COWNS; j++)
+      {
+        auto& log = logs[j];
+        switch (i % 8)
+        {
+          case 3:
+            when(log, logs[(j + 1) % COWNS]) << [i](auto a, auto b) {
+              a->entries.push_back(i);
+              UNUSED(b);
+            };
+            break;
+
+          case 5:
+            when(read(log)) << [i](auto l) {
+              if (l->entries.size() != i)
+                abort();
+            };
+            when(log) << [i](auto l) { l->entries.push_back(i); };
+            break;
+
+          case 6:
+            when(log).priority(Priority::High) <<
+              [i](auto l) { l->entries.push_back(i); };
+            break;
+
+          default:
+            when(log) << [i](auto l) { l->entries.push_back(i); };
+            break;
+        }
+      }
+    }
+
+    for (auto& log : logs)
+    {
+      when(log) << [](auto l) {
+        if (l->entries.size() != ENTRIES)
+          abort();
+        for (size_t i = 0; i < ENTRIES; i++)
+        {
+          if (l->entries[i] != i)
+            abort();
+        }
+        checked++;
+      };
+    }
+  };
+}
+
+int main(int argc, char** argv)
+{
+  SystematicTestHarness harness(argc, argv);
+  auto seeds = harness.seed_upper - harness.seed_lower;
+
+  auto budget = Scheduler::get_coalesce_budget();
+  for (size_t b : {0, 1, 16})
+  {
+    Scheduler::set_coalesce_budget(b);
+    harness.run(test_order);
+  }
+  Scheduler::set_coalesce_budget(budget);
+
+  if (checked != 3 * seeds * COWNS)
+  {
+    std::cout << "Checked " << checked << " cowns" << std::endl;
+    return 1;
+  }
+
+  return 0;
+}
@@ -0,0 +1,80 @@
+// Copyright Microsoft and Project Verona Contributors.
+// SPDX-License-Identifier: MIT
+
+#include <cpp/when.h>
+#include <debug/harness.h>
+
+using namespace verona::cpp;
+
+struct Counter
+{
+  size_t count = 0;
+};
+
+static constexpr size_t DEADLINE_COUNT = 20;
+static constexpr size_t LOOP_COUNT = 100;
+
+static std::atomic<size_t> ran;
+static std::atomic<bool> normal_ran;
+
+/**
+ * Work with deadlines that is waiting on a core runs earliest deadline first,
+ * whatever order it was scheduled in.
+ */
+void test_earliest_first()
+{
+  ran = 0;
+
+  when() << []() {
+    auto base = Aal::tick();
+
+    for (size_t i = 0; i < DEADLINE_COUNT; i++)
+    {
+      // Schedule the latest deadlines first.
+      size_t expected = DEADLINE_COUNT - 1 - i;
+      auto deadline = base + (expected * 1000);
+
+      when(make_cown<Counter>()).deadline(deadline) << [expected](auto) {
+        check(ran++ == expected);
+      };
+    }
+  };
+}
+
+void loop(cown_ptr<Counter> c)
+{
+  // Always due now, so would be taken first without turns.
+  when(c).deadline(Aal::tick()) << [c](auto counter) {
+    if (++counter->count < LOOP_COUNT)
+    {
+      loop(c);
+      return;
+    }
+
+    // Other normal priority work is not starved by deadline work.
+    check(normal_ran);
+  };
+}
+
+void test_normal_not_starved()
+{
+  normal_ran = false;
+
+  when() << []() {
+    loop(make_cown<Counter>());
+    when(make_cown<Counter>()) << [](auto) { normal_ran = true; };
+  };
+}
+
+int main(int argc, char** argv)
+{
+  SystematicTestHarness harness(argc, argv);
+
+  // Deadlines order the work of a single core.
+  harness.cores = 1;
+
+  harness.run(test_earliest_first);
+  harness.run(test_normal_not_starved);
+
+  return 0;
+}
@@ -51,8 +51,11 @@
  *     3      Early release: finish
  * ---------------------------
  */
+#include <cpp/when.h>
 #include <debug/harness.h>
 
+using namespace verona::cpp;
+
 struct A : public VCown<A>
 {};
 
@@ -60,6 +63,7 @@ struct B : public VCown<B>
 {};
 
 std::atomic<bool> flag = false;
+
 void start()
 {
   Logging::cout() << "Early release: start" << Logging::endl;
@@ -96,11 +100,10 @@ void early_release_test(bool first, bool second)
   schedule_lambda(2, cowns, [=]() {
     start();
 
-    // TODO readd early release
-    // if (first)
-    //   a->release_early();
-    // if (second)
-    //   b->release_early();
+    if (first)
+      check(Behaviour::release_early(a));
+    if (second)
+      check(Behaviour::release_early(b));
     yield();
 
     finished();
@@ -122,6 +125,49 @@ void early_release_test(bool first, bool second)
     Cown::release(alloc, b);
 }
 
+struct Account
+{
+  int64_t balance = 0;
+};
+
+/**
+ * The same through `acquired_cown::release`.  Successors on a released cown
+ * see the updates made before it was released, while successors on a cown
+ * that is kept still wait for the whole body.
+ */
+void acquired_release_test()
+{
+  auto from = make_cown<Account>();
+  auto to = make_cown<Account>();
+
+  when(from, to) << [](auto f, auto t) {
+    start();
+    f->balance -= 10;
+    f.release();
+    yield();
+    t->balance += 10;
+    finished();
+  };
+
+  when(from) << [](auto f) {
+    check(f->balance == -10);
+    interleave();
+  };
+
+  when(to) << [](auto t) {
+    check(t->balance == 10);
+    check(flag);
+  };
+
+  // Releasing one of a duplicated pair releases the cown once.
+  when(from, from) << [](auto f1, auto f2) {
+    f1.release();
+    f2.release();
+  };
+
+  when(read(from)) << [](auto f) { check(f->balance == -10); };
+}
+
 int main(int argc, char** argv)
 {
   SystematicTestHarness harness(argc, argv);
@@ -129,6 +175,7 @@ int main(int argc, char** argv)
   harness.run(early_release_test, true, false);
   harness.run(early_release_test, false, true);
   harness.run(early_release_test, true, true);
+  harness.run(acquired_release_test);
 
   return 0;
 }
@@ -0,0 +1,84 @@
+// Copyright Microsoft and Project Verona Contributors.
+// SPDX-License-Identifier: MIT
+
+#include <cpp/when.h>
+#include <debug/harness.h>
+
+using namespace verona::cpp;
+
+struct Counter
+{
+  size_t count = 0;
+};
+
+static constexpr size_t CHAINS = 8;
+static constexpr size_t LENGTH = 60;
+
+static std::atomic<size_t> finished{0};
+
+/**
+ * A chain of behaviours on one cown.  The first chain changes the number of
+ * active cores part way through, if `resize` is set.
+ */
+void chain(cown_ptr<Counter> c, size_t index, bool resize)
+{
+  when(c) << [c, index, resize](auto counter) {
+    auto n = ++counter->count;
+
+    // Long enough for the automatic policy to make decisions.
+    if (!resize)
+      busy_loop(100);
+
+    if (resize && index == 0)
+    {
+      if (n == LENGTH / 3)
+        Scheduler::set_active_cores(1);
+      else if (n == (2 * LENGTH) / 3)
+        Scheduler::set_active_cores(3);
+    }
+
+    if (n < LENGTH)
+      chain(c, index, resize);
+    else
+      finished++;
+  };
+}
+
+/**
+ * Shrinking and growing the pool while it runs loses no work.
+ */
+void test_resize()
+{
+  for (size_t i = 0; i < CHAINS; i++)
+    chain(make_cown<Counter>(), i, true);
+}
+
+/**
+ * The automatic policy loses no work.
+ */
+void test_auto()
+{
+  Scheduler::set_elastic_policy(ElasticPolicy::Auto, 1, 4);
+
+  for (size_t i = 0; i < CHAINS; i++)
+    chain(make_cown<Counter>(), i, false);
+}
+
+int main(int argc, char** argv)
+{
+  SystematicTestHarness harness(argc, argv);
+  auto seeds = harness.seed_upper - harness.seed_lower;
+
+  harness.run(test_resize);
+  harness.run(test_auto);
+
+  Scheduler::set_elastic_policy(ElasticPolicy::Fixed);
+
+  if (finished != 2 * seeds * CHAINS)
+  {
+    std::cout << "Finished " << finished << " chains" << std::endl;
+    return 1;
+  }
+
+  return 0;
+}
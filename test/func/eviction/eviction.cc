@@ -0,0 +1,85 @@
+// Copyright Microsoft and Project Verona Contributors.
+// SPDX-License-Identifier: MIT
+#include <cown_swapping/eviction_index.h>
+#include <iostream>
+
+using namespace verona::cpp;
+
+// Cowns are never dereferenced by the index, so stand-ins are enough.
+static verona::rt::Cown* fake(uintptr_t i)
+{
+  return (verona::rt::Cown*)((i + 1) * 64);
+}
+
+static uintptr_t key(verona::rt::Cown* cown)
+{
+  return (uintptr_t)cown / 64 - 1;
+}
+
+int main()
+{
+  bool failed = false;
+  size_t count = 1000;
+
+  // Inserted cowns are only visible once drained.
+  EvictionIndex index;
+  for (uintptr_t i = 0; i < count; i++)
+    index.insert({fake(i), 1});
+  if (!index.empty())
+  {
+    failed = true;
+    std::cout << "Index not empty before drain" << std::endl;
+  }
+  index.drain();
+
+  // Sampled picks should come from the smallest keys, and every cown is
+  // picked exactly once.
+  std::vector<bool> seen(count, false);
+  size_t late_picks = 0;
+  for (size_t i = 0; i < count; i++)
+  {
+    auto cown = index.pick_sampled(key);
+    auto k = key(cown.first);
+    if (cown.first == nullptr || seen[k])
+    {
+      failed = true;
+      std::cout << "Bad pick " << k << std::endl;
+      break;
+    }
+    seen[k] = true;
+
+    // Among the remaining cowns, the pick should be in the lower half.
+    size_t rank = 0;
+    for (size_t j = 0; j < k; j++)
+      rank += seen[j] ? 0 : 1;
+    if (rank > (count - i) / 2)
+      late_picks++;
+  }
+  if (late_picks > 10 || index.pick_sampled(key).first != nullptr)
+  {
+    failed = true;
+    std::cout << "Late picks: " << late_picks << std::endl;
+  }
+
+  // The clock skips cowns given a second chance, until a full revolution.
+  for (uintptr_t i = 0; i < 10; i++)
+    index.insert({fake(i), 1});
+  index.drain();
+  auto cown = index.pick_clock([](verona::rt::Cown* c) { return key(c) < 5; });
+  if (key(cown.first) != 5)
+  {
+    failed = true;
+    std::cout << "Clock picked " << key(cown.first) << std::endl;
+  }
+  cown = index.pick_clock([](verona::rt::Cown*) { return true; });
+  if (cown.first == nullptr || index.size() != 8)
+  {
+    failed = true;
+    std::cout << "Clock did not pick after a revolution" << std::endl;
+  }
+
+  if (failed)
+    return 1;
+  else
+    return 0;
+}
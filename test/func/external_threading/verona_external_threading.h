@@ -29,6 +29,25 @@ namespace verona::rt
     {
       return index;
     }
+
+    /**
+     * How far apart two CPU IDs returned by get() are, from 0 for the same
+     * physical core to 3 for different NUMA nodes. Scheduler threads steal
+     * from nearer cores first.
+     */
+    size_t distance(size_t, size_t)
+    {
+      return 0;
+    }
+
+    /**
+     * The NUMA node of a CPU ID returned by get(). Scheduler threads on the
+     * same node pause and are woken separately from other nodes.
+     */
+    size_t numa_node(size_t)
+    {
+      return 0;
+    }
   };
 
   namespace cpu
@@ -0,0 +1,70 @@
+// Copyright Microsoft and Project Verona Contributors.
+// SPDX-License-Identifier: MIT
+#include <algorithm>
+#include <ds/keysort.h>
+#include <iostream>
+#include <test/xoroshiro.h>
+#include <vector>
+
+using namespace verona::rt;
+
+struct Item
+{
+  uint64_t key;
+  size_t position;
+};
+
+/**
+ * Sorts `count` items, with keys drawn from `keys` distinct values spread by
+ * `stride`, and checks the result against `std::stable_sort`.
+ */
+bool check(xoroshiro::p128r32& r, size_t count, size_t keys, uint64_t stride)
+{
+  std::vector<Item> items(count);
+  for (size_t i = 0; i < count; i++)
+    items[i] = {(r.next() % keys) * stride, i};
+
+  auto expected = items;
+  std::stable_sort(
+    expected.begin(), expected.end(), [](const Item& a, const Item& b) {
+      return a.key < b.key;
+    });
+
+  KeySort::sort(items.data(), count, [](const Item& i) { return i.key; });
+
+  for (size_t i = 0; i < count; i++)
+  {
+    if (
+      items[i].key != expected[i].key ||
+      items[i].position != expected[i].position)
+    {
+      std::cout << "Mismatch at " << i << " of " << count << " with " << keys
+                << " keys, stride " << stride << std::endl;
+      return false;
+    }
+  }
+  return true;
+}
+
+int main()
+{
+  xoroshiro::p128r32 r(7);
+  bool ok = true;
+
+  // Covers the sorting networks, insertion sort, std::sort and radix sort,
+  // with many duplicates, few duplicates, and pointer-like keys whose low and
+  // high bits are all the same.
+  for (size_t count = 0; count < 600; count += (count < 40 ? 1 : 37))
+  {
+    for (size_t keys : {(size_t)1, (size_t)3, count + 1, (size_t)1 << 20})
+    {
+      for (uint64_t stride : {(uint64_t)1, (uint64_t)0x40, (uint64_t)1 << 44})
+      {
+        for (size_t rep = 0; rep < 4; rep++)
+          ok &= check(r, count, keys, stride);
+      }
+    }
+  }
+
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,79 @@
+// Copyright Microsoft and Project Verona Contributors.
+// SPDX-License-Identifier: MIT
+#include <cown_swapping/memory_accounting.h>
+#include <iostream>
+#include <thread>
+
+using namespace verona::cpp;
+using namespace std::chrono;
+
+int main()
+{
+  bool failed = false;
+
+  // Usage is not sampled until the first call to sample, so only counts
+  // resident bytes.
+  MemoryAccounting accounting(1000, hours(1));
+  accounting.add_resident(600);
+  accounting.add_resident(300);
+  accounting.remove_resident(100);
+  if (accounting.get_resident() != 800 || accounting.get_usage() != 800)
+  {
+    failed = true;
+    std::cout << "Resident bytes " << accounting.get_resident() << std::endl;
+  }
+
+  // Crossing the high watermark wakes the waiting thread long before its
+  // timeout.
+  auto start = steady_clock::now();
+  std::thread producer([&accounting]() {
+    std::this_thread::sleep_for(milliseconds(10));
+    accounting.add_resident(500);
+  });
+  accounting.wait_until(steady_clock::now() + seconds(30));
+  producer.join();
+  if (steady_clock::now() - start > seconds(10))
+  {
+    failed = true;
+    std::cout << "Not woken by crossing the watermark" << std::endl;
+  }
+
+  // Staying above the watermark does not wake it again.
+  accounting.add_resident(100);
+  start = steady_clock::now();
+  accounting.wait_until(start + milliseconds(20));
+  if (steady_clock::now() - start < milliseconds(20))
+  {
+    failed = true;
+    std::cout << "Woken without crossing the watermark" << std::endl;
+  }
+
+  // The allocator is sampled on the first call, then not again until the
+  // interval has passed.
+  accounting.sample(steady_clock::now());
+  auto usage = accounting.get_usage();
+  accounting.clear_resident();
+  if (usage < 1400 || accounting.get_usage() != usage - 1400)
+  {
+    failed = true;
+    std::cout << "Usage " << usage << " after sampling" << std::endl;
+  }
+
+  // Until the first sample, one is due straight away, and then one interval
+  // after the last.
+  MemoryAccounting sampled(0, milliseconds(10));
+  auto now = steady_clock::now();
+  if (sampled.next_sample(now) != now)
+  {
+    failed = true;
+    std::cout << "First sample not due immediately" << std::endl;
+  }
+  sampled.sample(now);
+  if (sampled.next_sample(now) != now + milliseconds(10))
+  {
+    failed = true;
+    std::cout << "Next sample not due after the interval" << std::endl;
+  }
+
+  return failed ? 1 : 0;
+}
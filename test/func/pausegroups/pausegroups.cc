@@ -0,0 +1,89 @@
+// Copyright Microsoft and Project Verona Contributors.
+// SPDX-License-Identifier: MIT
+
+#include <cpp/when.h>
+#include <debug/harness.h>
+
+using namespace verona::cpp;
+
+struct Counter
+{
+  size_t count = 0;
+};
+
+static constexpr size_t BURSTS = 10;
+static constexpr size_t BURST_SIZE = 8;
+
+static std::atomic<size_t> ran{0};
+
+/**
+ * Bursts of independent work, separated by a single behaviour, so threads
+ * repeatedly park and are woken across the pause groups.
+ */
+void burst(size_t remaining)
+{
+  when() << [remaining]() {
+    for (size_t i = 0; i < BURST_SIZE; i++)
+    {
+      when(make_cown<Counter>()) << [](auto counter) {
+        counter->count++;
+        ran++;
+      };
+    }
+
+    if (remaining > 1)
+      burst(remaining - 1);
+  };
+}
+
+void test_bursts()
+{
+  burst(BURSTS);
+}
+
+/**
+ * Many chains on their own cowns end, so every thread parks, and the runtime
+ * tears down, with threads parked in several groups.
+ */
+void chain(cown_ptr<Counter> c)
+{
+  when(c) << [c](auto counter) {
+    ran++;
+    if (++counter->count < BURST_SIZE)
+      chain(c);
+  };
+}
+
+void test_chains()
+{
+  for (size_t i = 0; i < BURST_SIZE; i++)
+    chain(make_cown<Counter>());
+}
+
+int main(int argc, char** argv)
+{
+  SystematicTestHarness harness(argc, argv);
+  auto seeds = harness.seed_upper - harness.seed_lower;
+
+  // A group per core, and groups of uneven sizes.
+  size_t runs = 0;
+  for (size_t group_cores : {1, 3})
+  {
+    Scheduler::set_pause_group_cores(group_cores);
+    harness.run(test_bursts);
+    harness.run(test_chains);
+    runs++;
+  }
+
+  Scheduler::set_pause_group_cores(16);
+
+  auto per_run = (BURSTS * BURST_SIZE) + (BURST_SIZE * BURST_SIZE);
+  auto expected = runs * seeds * per_run;
+  if (ran != expected)
+  {
+    std::cout << "Ran " << ran << " of " << expected << std::endl;
+    return 1;
+  }
+
+  return 0;
+}
@@ -0,0 +1,76 @@
+// Copyright Microsoft and Project Verona Contributors.
+// SPDX-License-Identifier: MIT
+
+#include <cpp/when.h>
+#include <debug/harness.h>
+
+using namespace verona::cpp;
+
+struct Counter
+{
+  size_t count = 0;
+};
+
+static constexpr size_t NORMAL_COUNT = 20;
+static constexpr size_t LOOP_COUNT = 100;
+
+static std::atomic<size_t> normal_ran;
+static std::atomic<bool> low_ran;
+
+/**
+ * High priority work overtakes normal priority work already waiting on the
+ * core.  Each other priority may get a single turn first, so only check it is
+ * not run last.
+ */
+void test_high_overtakes()
+{
+  normal_ran = 0;
+
+  when() << []() {
+    for (size_t i = 0; i < NORMAL_COUNT; i++)
+      when() << []() { normal_ran++; };
+
+    when().priority(Priority::High) << []() {
+      Logging::cout() << "High ran after " << normal_ran << " normal"
+                      << Logging::endl;
+      check(normal_ran < NORMAL_COUNT);
+    };
+  };
+}
+
+void loop(cown_ptr<Counter> c)
+{
+  when(c).priority(Priority::High) << [c](auto counter) {
+    if (++counter->count < LOOP_COUNT)
+    {
+      loop(c);
+      return;
+    }
+
+    // Low priority work is not starved by a stream of high priority work.
+    check(low_ran);
+  };
+}
+
+void test_low_not_starved()
+{
+  low_ran = false;
+
+  when() << []() {
+    loop(make_cown<Counter>());
+    when().priority(Priority::Low) << []() { low_ran = true; };
+  };
+}
+
+int main(int argc, char** argv)
+{
+  SystematicTestHarness harness(argc, argv);
+
+  // Priorities order the work of a single core.
+  harness.cores = 1;
+
+  harness.run(test_high_overtakes);
+  harness.run(test_low_not_starved);
+
+  return 0;
+}
@@ -72,8 +72,130 @@ void test_read_only_fast_send()
     };
 }
 
+struct Register
+{
+  size_t value{0};
+  // Number of readers currently running, so writers can check exclusion.
+  mutable std::atomic<size_t> readers{0};
+};
+
+void test_read_only_concurrent()
+{
+  size_t rounds = 4;
+  size_t readers = 6;
+
+  cown_ptr<Register> reg = make_cown<Register>();
+
+  for (size_t r = 0; r < rounds; r++)
+  {
+    for (size_t i = 0; i < readers; i++)
+    {
+      when(read(reg)) << [r](acquired_cown<const Register> reg) {
+        reg->readers++;
+        yield();
+        check(reg->value == r);
+        yield();
+        reg->readers--;
+      };
+    }
+
+    when(reg) << [r](acquired_cown<Register> reg) {
+      check(reg->readers == 0);
+      check(reg->value == r);
+      yield();
+      reg->value++;
+    };
+  }
+
+  // A read and a write of the same cown in one behaviour needs write access.
+  when(read(reg), reg) <<
+    [rounds](acquired_cown<const Register> ro, acquired_cown<Register> rw) {
+      check(rw->readers == 0);
+      check(ro->value == rounds);
+    };
+}
+
+void test_read_only_batch()
+{
+  // In one batch, a behaviour that reads and writes the same cown must still
+  // exclude the reader before it and the reader after it.
+  cown_ptr<Register> reg = make_cown<Register>();
+
+  auto reader = []() {
+    return [](acquired_cown<const Register> reg) {
+      reg->readers++;
+      yield();
+      reg->readers--;
+    };
+  };
+
+  (when(read(reg)) << reader()) +
+    (when(read(reg), reg) <<
+     [](acquired_cown<const Register>, acquired_cown<Register> rw) {
+       check(rw->readers == 0);
+       yield();
+       rw->value++;
+     }) +
+    (when(read(reg)) << reader());
+}
+
+constexpr size_t OUT_OF_ORDER_ROUNDS = 4;
+std::atomic<size_t> out_of_order_writes{0};
+
+void test_read_only_out_of_order()
+{
+  // A later reader finishes before an earlier one, with a writer queued
+  // behind them.  The earlier reader sends new behaviours once the later one
+  // is done, so the later reader's memory is likely to be reused.  The writer
+  // must still run, once both readers have finished.
+  size_t rounds = OUT_OF_ORDER_ROUNDS;
+
+  cown_ptr<Register> reg = make_cown<Register>();
+  cown_ptr<Register> other = make_cown<Register>();
+  auto done = std::make_shared<std::atomic<size_t>>(0);
+
+  for (size_t r = 0; r < rounds; r++)
+  {
+    when(read(reg)) << [r, done, other](acquired_cown<const Register> reg) {
+      reg->readers++;
+      for (size_t i = 0; i < 100 && *done <= r; i++)
+        yield();
+      for (size_t i = 0; i < 8; i++)
+        when(other) << [r, done](acquired_cown<Register> other) {
+          other->value += r + *done;
+        };
+      check(reg->value == r);
+      reg->readers--;
+    };
+
+    when(read(reg)) << [r, done](acquired_cown<const Register> reg) {
+      check(reg->value == r);
+      (*done)++;
+    };
+
+    when(reg) << [r](acquired_cown<Register> reg) {
+      check(reg->readers == 0);
+      check(reg->value == r);
+      reg->value++;
+      out_of_order_writes++;
+    };
+  }
+}
+
 int main(int argc, char** argv)
 {
   SystematicTestHarness harness(argc, argv);
+  auto seeds = harness.seed_upper - harness.seed_lower;
+
   harness.run(test_read_only);
+  harness.run(test_read_only_fast_send);
+  harness.run(test_read_only_concurrent);
+  harness.run(test_read_only_batch);
+  harness.run(test_read_only_out_of_order);
+
+  if (out_of_order_writes != seeds * OUT_OF_ORDER_ROUNDS)
+  {
+    std::cout << "Ran " << out_of_order_writes << " writes" << std::endl;
+    return 1;
+  }
 }
\ No newline at end of file
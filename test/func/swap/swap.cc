@@ -0,0 +1,329 @@
+// Copyright Microsoft and Project Verona Contributors.
+// SPDX-License-Identifier: MIT
+#include <cpp/cown_swapper.h>
+#include <cpp/when.h>
+#include <debug/harness.h>
+
+using namespace verona::cpp;
+
+struct Counter
+{
+  size_t value;
+
+  Counter(size_t value) : value(value) {}
+
+  static Counter* serialize(Counter* counter, std::iostream& archive)
+  {
+    if (counter == nullptr)
+    {
+      size_t value;
+      archive.read((char*)&value, sizeof(value));
+      return new Counter(value);
+    }
+
+    archive.write((char*)&counter->value, sizeof(counter->value));
+    return nullptr;
+  }
+
+  static size_t size(Counter*)
+  {
+    return sizeof(size_t);
+  }
+};
+
+/**
+ * Value swapped through the zero-copy interface, spread over two buffers.
+ */
+struct Blob
+{
+  size_t id;
+  size_t length;
+  char* data;
+
+  Blob(size_t id, size_t length) : id(id), length(length), data(new char[length])
+  {
+    for (size_t i = 0; i < length; i++)
+      data[i] = (char)(id + i);
+  }
+
+  ~Blob()
+  {
+    delete[] data;
+  }
+
+  bool check_contents(size_t expected)
+  {
+    if (id != expected)
+      return false;
+    for (size_t i = 0; i < length; i++)
+      if (data[i] != (char)(id + i))
+        return false;
+    return true;
+  }
+
+  static void gather(Blob* blob, std::vector<iovec>& buffers)
+  {
+    buffers.push_back({&blob->id, sizeof(blob->id)});
+    buffers.push_back({blob->data, blob->length});
+  }
+
+  static Blob* scatter(size_t size, std::vector<iovec>& buffers)
+  {
+    auto blob = new Blob(0, size - sizeof(size_t));
+    gather(blob, buffers);
+    return blob;
+  }
+
+  static size_t size(Blob* blob)
+  {
+    return sizeof(blob->id) + blob->length;
+  }
+};
+
+/**
+ * Swaps cowns out and back in again, checking their contents survive and
+ * that behaviours on the cowns are still ordered around the swaps.
+ */
+void test_swap()
+{
+  size_t num_cowns = 4;
+  size_t rounds = 3;
+
+  std::vector<cown_ptr<Counter*>> counters;
+  for (size_t i = 0; i < num_cowns; i++)
+    counters.push_back(make_cown<Counter*>(new Counter(i)));
+
+  for (size_t r = 0; r < rounds; r++)
+  {
+    for (size_t i = 0; i < num_cowns; i++)
+    {
+      when(counters[i]) << [i, r, num_cowns](acquired_cown<Counter*> c) {
+        check((*c)->value == i + r * num_cowns);
+        (*c)->value += num_cowns;
+      };
+
+      ActualCownSwapper::schedule_swap(counters[i]);
+    }
+  }
+
+  for (size_t i = 0; i < num_cowns; i++)
+  {
+    when(counters[i]) << [i, rounds, num_cowns](acquired_cown<Counter*> c) {
+      check((*c)->value == i + rounds * num_cowns);
+    };
+  }
+
+  // A cown can be collected while it is swapped out.
+  auto dropped = make_cown<Counter*>(new Counter(0));
+  ActualCownSwapper::schedule_swap(dropped);
+}
+
+/**
+ * Swaps values that are written and read in place, without serialization.
+ */
+void test_swap_zero_copy()
+{
+  size_t num_cowns = 3;
+
+  std::vector<cown_ptr<Blob*>> blobs;
+  for (size_t i = 0; i < num_cowns; i++)
+  {
+    blobs.push_back(make_cown<Blob*>(new Blob(i + 1, 1000 * i)));
+    ActualCownSwapper::schedule_swap(blobs[i]);
+  }
+
+  for (size_t i = 0; i < num_cowns; i++)
+  {
+    when(blobs[i]) << [i](acquired_cown<Blob*> b) {
+      check((*b)->check_contents(i + 1));
+    };
+    ActualCownSwapper::schedule_swap(blobs[i]);
+  }
+}
+
+/**
+ * Swaps several cowns as one record, then fetches them back individually.
+ */
+void test_swap_batch()
+{
+  size_t num_cowns = 5;
+
+  std::vector<cown_ptr<Counter*>> counters;
+  std::vector<cown_ptr<Blob*>> blobs;
+  for (size_t i = 0; i < num_cowns; i++)
+  {
+    counters.push_back(make_cown<Counter*>(new Counter(i)));
+    blobs.push_back(make_cown<Blob*>(new Blob(i + 1, 100 * i)));
+  }
+
+  ActualCownSwapper::schedule_swap(counters.data(), num_cowns);
+  ActualCownSwapper::schedule_swap(blobs.data(), num_cowns);
+
+  // Fetch in reverse, so the reads are not in record order.
+  for (size_t i = num_cowns; i-- > 0;)
+  {
+    when(counters[i]) << [i](acquired_cown<Counter*> c) {
+      check((*c)->value == i);
+    };
+    when(blobs[i]) << [i](acquired_cown<Blob*> b) {
+      check((*b)->check_contents(i + 1));
+    };
+  }
+
+  // Only some of the batch is fetched before the rest is collected.
+  ActualCownSwapper::schedule_swap(counters.data(), num_cowns);
+  when(counters[2]) << [](acquired_cown<Counter*> c) {
+    check((*c)->value == 2);
+  };
+}
+
+/**
+ * Requests cowns again while they are being swapped out, so their data is
+ * handed to the fetch rather than read back.
+ */
+void test_swap_readahead()
+{
+  ActualCownSwapper::set_readahead(true);
+
+  auto counter = make_cown<Counter*>(new Counter(7));
+  auto blob = make_cown<Blob*>(new Blob(3, 500));
+
+  for (size_t r = 0; r < 2; r++)
+  {
+    ActualCownSwapper::schedule_swap(counter);
+    ActualCownSwapper::schedule_swap(blob);
+
+    when(counter) << [](acquired_cown<Counter*> c) {
+      check((*c)->value == 7);
+    };
+    when(blob) << [](acquired_cown<Blob*> b) {
+      check((*b)->check_contents(3));
+    };
+  }
+
+  when(counter, blob) << [](acquired_cown<Counter*>, acquired_cown<Blob*>) {
+    ActualCownSwapper::set_readahead(false);
+  };
+}
+
+/**
+ * Cowns fetched together by one behaviour are prefetched together the next
+ * time one of them is fetched.
+ */
+void test_swap_correlation_prefetch()
+{
+  ActualCownSwapper::set_correlation_prefetch(true);
+
+  auto a = make_cown<Counter*>(new Counter(1));
+  auto b = make_cown<Counter*>(new Counter(2));
+
+  ActualCownSwapper::schedule_swap(a);
+  ActualCownSwapper::schedule_swap(b);
+
+  // Fetches both, and records that they are used together.
+  when(a, b) << [](acquired_cown<Counter*> a, acquired_cown<Counter*> b) {
+    check((*a)->value == 1);
+    check((*b)->value == 2);
+  };
+
+  ActualCownSwapper::schedule_swap(a);
+  ActualCownSwapper::schedule_swap(b);
+
+  // Fetching a also requests b.
+  when(a) << [b](acquired_cown<Counter*> a) mutable {
+    check((*a)->value == 1);
+    check(!ActualCownSwapper::debug_is_swapped(b));
+  };
+
+  when(a, b) << [](acquired_cown<Counter*>, acquired_cown<Counter*> b) {
+    check((*b)->value == 2);
+    // Release the weak references held by the correlation table.
+    ActualCownSwapper::set_correlation_prefetch(false);
+  };
+}
+
+/**
+ * Round trips data that does and does not compress through the codec.
+ */
+void test_lz_codec()
+{
+  verona::rt::LzCodec codec;
+
+  std::vector<std::string> inputs = {"", "abc", std::string(1000, 'x')};
+  std::string text;
+  for (size_t i = 0; i < 5000; i++)
+    text += std::to_string(i % 97);
+  inputs.push_back(text);
+  std::string noise;
+  for (size_t i = 0; i < 5000; i++)
+    noise.push_back((char)((i * 2654435761u) >> 13));
+  inputs.push_back(noise);
+
+  for (auto& input : inputs)
+  {
+    std::string compressed;
+    codec.compress(input.data(), input.size(), compressed);
+
+    std::string output(input.size(), '\0');
+    check(codec.decompress(compressed, output.data(), output.size()));
+    check(output == input);
+    check(!codec.decompress(compressed, output.data(), output.size() + 1));
+  }
+}
+
+/**
+ * Swaps cowns into the compressed tier, spilling those that do not fit to
+ * disk.
+ */
+void test_swap_compressed_tier()
+{
+  ActualCownSwapper::set_compressed_tier(4096);
+
+  auto counter = make_cown<Counter*>(new Counter(5));
+  auto small = make_cown<Blob*>(new Blob(1, 2000));
+  auto large = make_cown<Blob*>(new Blob(2, 8000));
+
+  for (size_t r = 0; r < 2; r++)
+  {
+    ActualCownSwapper::schedule_swap(counter);
+    ActualCownSwapper::schedule_swap(small);
+    ActualCownSwapper::schedule_swap(large);
+
+    when(counter, small, large) << [](
+                                     acquired_cown<Counter*> c,
+                                     acquired_cown<Blob*> s,
+                                     acquired_cown<Blob*> l) {
+      check((*c)->value == 5);
+      check((*s)->check_contents(1));
+      check((*l)->check_contents(2));
+    };
+  }
+
+  // Collected while held by the tier.
+  auto dropped = make_cown<Blob*>(new Blob(3, 100));
+  ActualCownSwapper::schedule_swap(dropped);
+
+  when(counter) << [](acquired_cown<Counter*>) {
+    ActualCownSwapper::set_compressed_tier(0);
+  };
+}
+
+int main(int argc, char** argv)
+{
+  SystematicTestHarness harness(argc, argv);
+
+  harness.run(test_swap);
+  harness.run(test_swap_zero_copy);
+  harness.run(test_swap_batch);
+  harness.run(test_swap_readahead);
+  harness.run(test_swap_correlation_prefetch);
+  test_lz_codec();
+  harness.run(test_swap_compressed_tier);
+
+  // Every record has been fetched or discarded, so the store holds no live
+  // data.
+  check(verona::rt::SwapStore::get().debug_usage().first == 0);
+  check(verona::rt::CompressedTier::get().debug_usage().first == 0);
+
+  return 0;
+}
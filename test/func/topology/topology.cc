@@ -0,0 +1,63 @@
+// Copyright Microsoft and Project Verona Contributors.
+// SPDX-License-Identifier: MIT
+#include <iostream>
+#include <pal/cpu.h>
+
+using namespace verona::rt;
+
+int main()
+{
+  bool failed = false;
+
+  Topology topology;
+  Topology::init(&topology);
+
+  // Distances are symmetric, and a CPU is its own sibling.
+  size_t count = topology.size();
+  size_t histogram[Topology::DISTANCES] = {};
+  for (size_t i = 0; i < count; i++)
+  {
+    auto a = topology.get(i);
+    if (topology.distance(a, a) != Topology::Sibling)
+    {
+      failed = true;
+      std::cout << "CPU " << a << " is not its own sibling" << std::endl;
+    }
+
+    for (size_t j = 0; j < count; j++)
+    {
+      auto b = topology.get(j);
+      auto d = topology.distance(a, b);
+      if (d != topology.distance(b, a))
+      {
+        failed = true;
+        std::cout << "Distance " << a << " to " << b << " is not symmetric"
+                  << std::endl;
+      }
+
+      if (
+        topology.numa_node(a) != topology.numa_node(b) &&
+        d != Topology::Remote)
+      {
+        failed = true;
+        std::cout << "CPUs " << a << " and " << b
+                  << " are on different nodes but not remote" << std::endl;
+      }
+      histogram[d]++;
+    }
+  }
+
+  std::cout << "CPU pairs by distance:";
+  for (auto pairs : histogram)
+    std::cout << " " << pairs;
+  std::cout << std::endl;
+
+  // CPUs that are not found are treated as far away.
+  if (topology.distance(topology.get(0), (size_t)-2) != Topology::Remote)
+  {
+    failed = true;
+    std::cout << "Unknown CPU is not remote" << std::endl;
+  }
+
+  return failed ? 1 : 0;
+}
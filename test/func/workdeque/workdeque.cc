@@ -0,0 +1,117 @@
+// Copyright Microsoft and Project Verona Contributors.
+// SPDX-License-Identifier: MIT
+#include <atomic>
+#include <iostream>
+#include <sched/workdeque.h>
+#include <thread>
+#include <vector>
+
+using namespace verona::rt;
+
+struct Item
+{
+  std::atomic<size_t> taken{0};
+};
+
+int main()
+{
+  bool failed = false;
+
+  // The owner pops newest first, thieves take oldest first.
+  {
+    WorkDeque<Item, 4> deque;
+    Item items[5];
+    for (size_t i = 0; i < 4; i++)
+      deque.push(&items[i]);
+
+    if (deque.push(&items[4]))
+    {
+      failed = true;
+      std::cout << "Pushed onto a full deque" << std::endl;
+    }
+
+    if (deque.pop() != &items[3] || deque.steal() != &items[0])
+    {
+      failed = true;
+      std::cout << "Wrong order" << std::endl;
+    }
+
+    deque.pop();
+    deque.pop();
+    if (!deque.empty() || deque.pop() != nullptr || deque.steal() != nullptr)
+    {
+      failed = true;
+      std::cout << "Not empty" << std::endl;
+    }
+  }
+
+  // With thieves racing the owner, every item is taken exactly once.
+  {
+    constexpr size_t ITEMS = 100000;
+    constexpr size_t THIEVES = 3;
+    WorkDeque<Item, 64> deque;
+    std::vector<Item> items(ITEMS);
+    std::atomic<bool> done{false};
+
+    std::vector<std::thread> thieves;
+    for (size_t i = 0; i < THIEVES; i++)
+    {
+      thieves.emplace_back([&]() {
+        while (!done.load())
+        {
+          auto item = deque.steal();
+          if (item != nullptr)
+            item->taken++;
+          else
+            std::this_thread::yield();
+        }
+      });
+    }
+
+    for (size_t i = 0; i < ITEMS; i++)
+    {
+      while (!deque.push(&items[i]))
+      {
+        auto item = deque.pop();
+        if (item != nullptr)
+          item->taken++;
+      }
+
+      // Pop roughly every third push.
+      if (i % 3 == 0)
+      {
+        auto item = deque.pop();
+        if (item != nullptr)
+          item->taken++;
+      }
+    }
+
+    Item* item;
+    while ((item = deque.pop()) != nullptr || !deque.empty())
+    {
+      if (item != nullptr)
+        item->taken++;
+    }
+
+    done = true;
+    for (auto& t : thieves)
+      t.join();
+
+    for (size_t i = 0; i < ITEMS; i++)
+    {
+      if (items[i].taken != 1)
+      {
+        failed = true;
+        std::cout << "Item " << i << " taken " << items[i].taken << " times"
+                  << std::endl;
+        break;
+      }
+    }
+  }
+
+  if (failed)
+    return 1;
+
+  std::cout << "Done" << std::endl;
+  return 0;
+}
@@ -0,0 +1,107 @@
+// Copyright Microsoft and Project Verona Contributors.
+// SPDX-License-Identifier: MIT
+
+/**
+ * Measures the cost of scheduling behaviours on many cowns at once.
+ *
+ * For each arity, a behaviour spawns `--spawns` behaviours, each on a
+ * `cown_array` of that many cowns picked at random from `--cowns` cowns, so
+ * the runtime has to sort every behaviour's requests into cown order before
+ * acquiring them.  This reports the fastest spawning loop's time per `when`
+ * and per cown requested, over `--repeats` runs.  `--arity` measures one
+ * arity only.
+ */
+
+#include "test/opt.h"
+#include "test/xoroshiro.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cpp/when.h>
+#include <debug/harness.h>
+#include <random>
+#include <vector>
+
+using namespace verona::cpp;
+using Clock = std::chrono::steady_clock;
+
+struct Counter
+{
+  size_t count = 0;
+};
+
+/// Fastest spawning loop in the current run.
+static Clock::duration spawn_time;
+
+void spawn(std::vector<cown_ptr<Counter>> cowns, size_t arity, size_t spawns)
+{
+  when() << [cowns = std::move(cowns), arity, spawns]() {
+    // Pick the cowns up front, so the loop only measures scheduling.
+    xoroshiro::p128r32 r(arity);
+    std::vector<cown_ptr<Counter>> picked(arity * spawns);
+    for (size_t i = 0; i < spawns; i++)
+    {
+      // Consecutive cowns from a random start are distinct, then shuffled.
+      auto start = r.next();
+      auto first = picked.begin() + (ptrdiff_t)(i * arity);
+      for (size_t j = 0; j < arity; j++)
+        first[(ptrdiff_t)j] = cowns[(start + j) % cowns.size()];
+      std::shuffle(first, first + (ptrdiff_t)arity, std::minstd_rand(i));
+    }
+
+    auto begin = Clock::now();
+    for (size_t i = 0; i < spawns; i++)
+    {
+      cown_array<Counter> array{&picked[i * arity], arity};
+      when(array) << [](auto s) {
+        for (size_t j = 0; j < s.length; j++)
+          s.array[j]->count++;
+      };
+    }
+    spawn_time = std::min(spawn_time, Clock::now() - begin);
+  };
+}
+
+int main(int argc, char** argv)
+{
+  opt::Opt opt(argc, argv);
+
+  const auto cores = opt.is<size_t>("--cores", 4);
+  const auto spawns = opt.is<size_t>("--spawns", 500);
+  const auto cown_count = opt.is<size_t>("--cowns", 2048);
+  const auto repeats = opt.is<size_t>("--repeats", 3);
+  const auto only = opt.is<size_t>("--arity", 0);
+
+  std::vector<size_t> arities = {2, 3, 4, 8, 16, 64, 256, 1024};
+  if (only != 0)
+    arities = {only};
+
+  auto& sched = Scheduler::get();
+  for (auto arity : arities)
+  {
+    if (arity > cown_count)
+      continue;
+
+    auto best = Clock::duration::max();
+    for (size_t r = 0; r < repeats; r++)
+    {
+      sched.init(cores);
+
+      std::vector<cown_ptr<Counter>> cowns;
+      for (size_t i = 0; i < cown_count; i++)
+        cowns.push_back(make_cown<Counter>());
+
+      spawn_time = Clock::duration::max();
+      spawn(std::move(cowns), arity, spawns);
+      sched.run();
+      best = std::min(best, spawn_time);
+    }
+
+    auto per_when =
+      std::chrono::duration<double, std::nano>(best).count() / (double)spawns;
+    std::cout << arity << " cowns: " << per_when << " ns/when, "
+              << per_when / (double)arity << " ns/cown" << std::endl;
+  }
+
+  snmalloc::debug_check_empty<snmalloc::Alloc::Config>();
+}
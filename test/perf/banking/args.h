@@ -7,6 +7,7 @@ inline size_t TRANSACTIONS = 50;
 inline size_t NUM_WORKERS = 36;
 inline size_t NUM_ACCOUNTS = 36;
 inline size_t WORK_USEC = 1000;
+inline size_t ACCOUNT_BYTES = 0;
 
 inline bool process_args(SystematicTestHarness& harness)
 {
@@ -14,6 +15,7 @@ inline bool process_args(SystematicTestHarness& harness)
   NUM_WORKERS = harness.opt.is<size_t>("--cores", NUM_WORKERS);
   WORK_USEC = harness.opt.is<size_t>("--work_usec", WORK_USEC);
   NUM_ACCOUNTS = harness.opt.is<size_t>("--accounts", NUM_ACCOUNTS);
+  ACCOUNT_BYTES = harness.opt.is<size_t>("--account_bytes", ACCOUNT_BYTES);
 
   return true;
 }
\ No newline at end of file
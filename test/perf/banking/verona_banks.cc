@@ -15,6 +15,19 @@ using namespace verona::cpp;
  * and finally, all the transactions are logged.
  *
  * There is a busy loop in the transactions.
+ *
+ * Each account can also carry `--account_bytes` of data that every
+ * transaction touches, so that where accounts run matters to the caches.
+ * Compare runs with and without `--affinity`, which routes transactions back
+ * to the core that last ran their first account, for example:
+ *
+ *   banking --work_usec 0 --account_bytes 65536 --num_trans 100000 --affinity
+ *
+ * Every transaction logs to one cown, so its behaviours queue up there.
+ * `--coalesce_budget` sets how many of them a thread runs back to back, see
+ * `Scheduler::set_coalesce_budget`, and 0 turns this off:
+ *
+ *   banking --work_usec 0 --num_trans 100000 --coalesce_budget 0
  */
 
 struct Account
@@ -22,11 +35,22 @@ struct Account
   int64_t balance;
   int64_t overdraft;
   size_t id;
+  std::vector<uint64_t> data;
 
   Account(int64_t balance, int64_t overdraft, size_t id)
-  : balance(balance), overdraft(overdraft), id(id)
+  : balance(balance),
+    overdraft(overdraft),
+    id(id),
+    data(ACCOUNT_BYTES / sizeof(uint64_t))
   {}
 
+  /// Write to every cache line of the account's data.
+  void touch()
+  {
+    for (size_t i = 0; i < data.size(); i += 64 / sizeof(uint64_t))
+      data[i]++;
+  }
+
   ~Account()
   {
     Logging::cout() << "Account " << id << " destroyed" << Logging::endl;
@@ -82,6 +106,8 @@ void bank_job(
          //  (auto from, auto to) {
          // We give explicit types for clarity.
          busy_loop(WORK_USEC);
+         from->touch();
+         to->touch();
 
          if ((from->balance + from->overdraft) < amount)
          {
@@ -133,7 +159,20 @@ void test_body()
 
 int verona_main(SystematicTestHarness& harness)
 {
+  auto affinity = harness.opt.has("--affinity");
+  Scheduler::set_affinity(affinity);
+
+  auto coalesce = harness.opt.is<size_t>(
+    "--coalesce_budget", Scheduler::get_coalesce_budget());
+  Scheduler::set_coalesce_budget(coalesce);
+
+  auto start = high_resolution_clock::now();
   harness.run(test_body);
+  auto elapsed =
+    duration_cast<milliseconds>(high_resolution_clock::now() - start);
+
+  std::cout << "Affinity " << (affinity ? "on" : "off") << ", coalesce budget "
+            << coalesce << ": " << elapsed.count() << " ms" << std::endl;
 
   return 0;
 }
@@ -0,0 +1,106 @@
+// Copyright Microsoft and Project Verona Contributors.
+// SPDX-License-Identifier: MIT
+
+/**
+ * This benchmark measures how read-only behaviours on a single cown scale
+ * with the number of cores.
+ *
+ * A single cown holds an array of values.  A number of behaviours each sum
+ * the array.  With `--write` the behaviours request write access instead,
+ * and so are serialised, which gives a baseline for comparison.
+ *
+ * Every `--writer_every` readers a write is scheduled, which splits the
+ * readers into separate groups.
+ */
+
+#include "test/opt.h"
+#include "verona.h"
+
+#include <cpp/when.h>
+#include <debug/harness.h>
+
+namespace sn = snmalloc;
+namespace rt = verona::rt;
+using namespace verona::cpp;
+
+struct Data
+{
+  std::vector<size_t> values;
+  size_t writes{0};
+
+  Data(size_t size) : values(size, 1) {}
+};
+
+std::atomic<size_t> total{0};
+
+size_t sum(const Data& d)
+{
+  size_t result = 0;
+  for (auto v : d.values)
+    result += v;
+  return result;
+}
+
+void run(size_t cores, size_t behaviours, size_t size, size_t writer_every, bool write)
+{
+  auto& sched = rt::Scheduler::get();
+  sched.init(cores);
+
+  auto data = make_cown<Data>(size);
+
+  for (size_t i = 0; i < behaviours; i++)
+  {
+    if (write)
+    {
+      when(data) << [](acquired_cown<Data> d) { total += sum(*d); };
+    }
+    else
+    {
+      when(read(data)) <<
+        [](acquired_cown<const Data> d) { total += sum(*d); };
+    }
+
+    if ((writer_every != 0) && ((i + 1) % writer_every == 0))
+      when(data) << [](acquired_cown<Data> d) { d->writes++; };
+  }
+
+  data = nullptr;
+
+  auto start = sn::Aal::tick();
+  sched.run();
+  auto end = sn::Aal::tick();
+
+  std::cout << "Cores: " << cores << " Time:" << (end - start) / behaviours
+            << std::endl;
+}
+
+int main(int argc, char** argv)
+{
+  for (int i = 0; i < argc; i++)
+  {
+    printf(" %s", argv[i]);
+  }
+  printf("\n");
+  opt::Opt opt(argc, argv);
+
+  const auto max_cores = opt.is<size_t>("--cores", 4);
+  const auto behaviours = opt.is<size_t>("--behaviours", 1000);
+  const auto size = opt.is<size_t>("--size", 1024);
+  const auto writer_every = opt.is<size_t>("--writer_every", 0);
+  const auto repeats = opt.is<size_t>("--repeats", 1);
+  const bool write = opt.has("--write");
+
+  size_t runs = 0;
+  for (size_t r = 0; r < repeats; r++)
+  {
+    for (size_t cores = 1; cores <= max_cores; cores *= 2)
+    {
+      run(cores, behaviours, size, writer_every, write);
+      runs++;
+    }
+  }
+
+  check(total == behaviours * size * runs);
+
+  snmalloc::debug_check_empty<snmalloc::Alloc::Config>();
+}
@@ -6,6 +6,14 @@
  *
  * There are n cowns, each executing m writes to a large statically allocated
  * array of memory.  Each cown performs c behaviours.
+ *
+ * With --burst, every cown is started from a single behaviour, so all the
+ * work lands on one core and the others have to steal it.  --steal_batch sets
+ * how many items one steal may take, to compare load balancing.
+ *
+ * Each run is repeated under each batching policy, reporting throughput and
+ * the latency from scheduling a behaviour to it starting.  --fixed or
+ * --adaptive run only that policy, and --batch sets the fixed batch size.
  */
 
 #include "debug/log.h"
@@ -13,8 +21,11 @@
 #include "test/xoroshiro.h"
 #include "verona.h"
 
+#include <algorithm>
 #include <chrono>
 #include <debug/harness.h>
+#include <mutex>
+#include <vector>
 
 namespace sn = snmalloc;
 namespace rt = verona::rt;
@@ -26,14 +37,20 @@ size_t global_array_size;
 // Number of writes on each iteration
 size_t writes;
 
+// Ticks from scheduling each behaviour to it starting, for the current run.
+std::mutex latencies_mutex;
+std::vector<uint64_t> latencies;
+
 struct LoopCown : public VCown<LoopCown>
 {
   size_t count;
   xoroshiro::p128r32 rng;
+  std::vector<uint64_t> waited;
 
   LoopCown(size_t count, size_t seed) : count(count)
   {
     rng.set_state(seed);
+    waited.reserve(count);
   }
 
   void go()
@@ -41,13 +58,19 @@ struct LoopCown : public VCown<LoopCown>
     if (count > 0)
     {
       count--;
-      schedule_lambda(this, [this]() {
+      auto scheduled = sn::Aal::tick();
+      schedule_lambda(this, [this, scheduled]() {
+        waited.push_back(sn::Aal::tick() - scheduled);
         work();
         go();
       });
     }
     else
     {
+      {
+        std::lock_guard<std::mutex> lock(latencies_mutex);
+        latencies.insert(latencies.end(), waited.begin(), waited.end());
+      }
       Cown::release(ThreadAlloc::get(), this);
     }
   }
@@ -63,6 +86,13 @@ struct LoopCown : public VCown<LoopCown>
   }
 };
 
+uint64_t percentile(std::vector<uint64_t>& sorted, double p)
+{
+  if (sorted.empty())
+    return 0;
+  return sorted[std::min(sorted.size() - 1, (size_t)(sorted.size() * p))];
+}
+
 int main(int argc, char** argv)
 {
   for (int i = 0; i < argc; i++)
@@ -80,24 +110,61 @@ int main(int argc, char** argv)
   global_array = new std::atomic<size_t>[global_array_size];
   const auto loops = opt.is<size_t>("--loops", 100);
   writes = opt.is<size_t>("--writes", 0);
+  const auto burst = opt.has("--burst");
+  const auto repeats = opt.is<size_t>("--repeats", 10);
+  const auto batch = opt.is<size_t>("--batch", 100);
+
+  std::vector<std::pair<const char*, rt::BatchPolicy>> policies;
+  if (!opt.has("--adaptive"))
+    policies.emplace_back("fixed", rt::BatchPolicy::Fixed);
+  if (!opt.has("--fixed"))
+    policies.emplace_back("adaptive", rt::BatchPolicy::Adaptive);
 
   auto& sched = rt::Scheduler::get();
   sched.set_fair(true);
-  for (int l = 0; l < 20; l++)
+  sched.set_steal_batch(opt.is<size_t>("--steal_batch", 32));
+  for (auto [name, policy] : policies)
   {
-    sched.init(cores);
+    sched.set_batch_policy(policy, batch);
+    latencies.clear();
+    std::chrono::steady_clock::duration elapsed{0};
 
-    for (size_t i = 0; i < cowns; i++)
+    for (size_t l = 0; l < repeats; l++)
     {
-      auto c = new LoopCown(loops, i + 200);
-      c->go();
+      sched.init(cores);
+
+      auto start_cowns = [cowns, loops]() {
+        for (size_t i = 0; i < cowns; i++)
+        {
+          auto c = new LoopCown(loops, i + 200);
+          c->go();
+        }
+      };
+
+      if (burst)
+        schedule_lambda(start_cowns);
+      else
+        start_cowns();
+
+      auto start_time = std::chrono::steady_clock::now();
+      auto start = sn::Aal::tick();
+      sched.run();
+      auto end = sn::Aal::tick();
+      elapsed += std::chrono::steady_clock::now() - start_time;
+      std::cout << "Time:" << (end - start) / (cowns * loops) << std::endl;
     }
 
-    auto start = sn::Aal::tick();
-    sched.run();
-    auto end = sn::Aal::tick();
-    std::cout << "Time:" << (end - start) / (cowns * loops) << std::endl;
+    std::sort(latencies.begin(), latencies.end());
+    auto seconds = std::chrono::duration<double>(elapsed).count();
+    std::cout << "Policy: " << name << std::endl;
+    std::cout << "  Throughput: " << (size_t)(latencies.size() / seconds)
+              << " behaviours/s" << std::endl;
+    std::cout << "  Latency (ticks) p50: " << percentile(latencies, 0.5)
+              << " p99: " << percentile(latencies, 0.99)
+              << " p99.9: " << percentile(latencies, 0.999)
+              << " max: " << percentile(latencies, 1.0) << std::endl;
   }
+  latencies = std::vector<uint64_t>();
   delete[] global_array;
   snmalloc::debug_check_empty<snmalloc::Alloc::Config>();
 }
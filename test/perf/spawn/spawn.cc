@@ -0,0 +1,182 @@
+// Copyright Microsoft and Project Verona Contributors.
+// SPDX-License-Identifier: MIT
+
+/**
+ * Measures the cost of spawning behaviours with `when`.
+ *
+ * A behaviour spawns `--spawns` small behaviours, over one cown, two cowns,
+ * or a `cown_array` of `--span` cowns, spread round `--cowns` cowns.  It then
+ * spawns a behaviour to do the same again, for `--rounds` rounds, so later
+ * rounds reuse the memory of the behaviours that have finished.  For each,
+ * this reports the fastest round's time per `when`, which is the cost of
+ * creating each behaviour and enqueueing it on its cowns, and the time until
+ * all of the behaviours had run, per behaviour.  The total is the best of
+ * `--repeats` runs.
+ *
+ * Then, for one and two cowns, a chain of `--chain` behaviours each spawns the
+ * next on the same cowns, which can only start once its spawner has finished.
+ * This reports the time per link of the chain, which is the latency from
+ * spawning a behaviour to it running.
+ */
+
+#include "test/opt.h"
+
+#include <chrono>
+#include <cpp/when.h>
+#include <debug/harness.h>
+#include <memory>
+#include <vector>
+
+using namespace verona::cpp;
+using Clock = std::chrono::steady_clock;
+
+struct Counter
+{
+  size_t count = 0;
+};
+
+using Cowns = std::vector<cown_ptr<Counter>>;
+
+void spawn_one(Cowns& cowns, size_t i, size_t)
+{
+  when(cowns[i % cowns.size()]) << [](auto c) { c->count++; };
+}
+
+void spawn_two(Cowns& cowns, size_t i, size_t)
+{
+  auto n = cowns.size();
+  when(cowns[i % n], cowns[(i + 1) % n]) << [](auto a, auto b) {
+    a->count++;
+    b->count++;
+  };
+}
+
+void spawn_span(Cowns& cowns, size_t i, size_t span)
+{
+  auto start = i % (cowns.size() - span + 1);
+  cown_array<Counter> array{&cowns[start], span};
+  when(array) << [](auto s) {
+    for (size_t j = 0; j < s.length; j++)
+      s.array[j]->count++;
+  };
+}
+
+/// Fastest spawning loop in the current run.
+static Clock::duration spawn_time;
+
+void spawn_round(
+  std::shared_ptr<Cowns> cowns,
+  void (*spawn)(Cowns&, size_t, size_t),
+  size_t spawns,
+  size_t span,
+  size_t rounds)
+{
+  when() << [=]() {
+    auto start = Clock::now();
+    for (size_t i = 0; i < spawns; i++)
+      spawn(*cowns, i, span);
+    spawn_time = std::min(spawn_time, Clock::now() - start);
+
+    if (rounds > 1)
+      spawn_round(cowns, spawn, spawns, span, rounds - 1);
+  };
+}
+
+/// When the current chain started and finished.
+static Clock::time_point chain_start;
+static Clock::time_point chain_end;
+
+template<bool two>
+void chain(cown_ptr<Counter> a, cown_ptr<Counter> b, size_t links)
+{
+  auto next = [a, b, links](auto...) {
+    if (links > 1)
+      chain<two>(a, b, links - 1);
+    else
+      chain_end = Clock::now();
+  };
+
+  if constexpr (two)
+    when(a, b) << std::move(next);
+  else
+    when(a) << std::move(next);
+}
+
+int main(int argc, char** argv)
+{
+  opt::Opt opt(argc, argv);
+
+  const auto cores = opt.is<size_t>("--cores", 4);
+  const auto spawns = opt.is<size_t>("--spawns", 2000);
+  const auto cown_count = std::max<size_t>(opt.is<size_t>("--cowns", 64), 2);
+  const auto span =
+    std::clamp<size_t>(opt.is<size_t>("--span", 4), 1, cown_count);
+  const auto rounds = std::max<size_t>(opt.is<size_t>("--rounds", 5), 1);
+  const auto repeats = opt.is<size_t>("--repeats", 3);
+  const auto links = std::max<size_t>(opt.is<size_t>("--chain", 2000), 1);
+
+  std::pair<const char*, void (*)(Cowns&, size_t, size_t)> variants[] = {
+    {"1 cown", &spawn_one}, {"2 cowns", &spawn_two}, {"span", &spawn_span}};
+
+  auto& sched = Scheduler::get();
+  for (auto [name, spawn] : variants)
+  {
+    auto best_spawn = Clock::duration::max();
+    auto best_total = Clock::duration::max();
+
+    for (size_t r = 0; r < repeats; r++)
+    {
+      sched.init(cores);
+
+      auto cowns = std::make_shared<Cowns>();
+      for (size_t i = 0; i < cown_count; i++)
+        cowns->push_back(make_cown<Counter>());
+
+      spawn_time = Clock::duration::max();
+      auto start = Clock::now();
+      spawn_round(std::move(cowns), spawn, spawns, span, rounds);
+      sched.run();
+      auto total = Clock::now() - start;
+
+      best_spawn = std::min(best_spawn, spawn_time);
+      best_total = std::min(best_total, total);
+    }
+
+    auto per = [spawns](Clock::duration d) {
+      return std::chrono::duration<double, std::nano>(d).count() /
+        (double)spawns;
+    };
+    std::cout << name << ": spawn " << per(best_spawn) << " ns/when, total "
+              << per(best_total) / (double)rounds << " ns/behaviour"
+              << std::endl;
+  }
+
+  std::pair<const char*, void (*)(cown_ptr<Counter>, cown_ptr<Counter>, size_t)>
+    chains[] = {{"1 cown", &chain<false>}, {"2 cowns", &chain<true>}};
+
+  for (auto [name, start_chain] : chains)
+  {
+    auto best = Clock::duration::max();
+
+    for (size_t r = 0; r < repeats; r++)
+    {
+      sched.init(cores);
+
+      auto a = make_cown<Counter>();
+      auto b = make_cown<Counter>();
+      when() << [=]() {
+        chain_start = Clock::now();
+        start_chain(a, b, links);
+      };
+      sched.run();
+
+      best = std::min(best, chain_end - chain_start);
+    }
+
+    auto per_link =
+      std::chrono::duration<double, std::nano>(best).count() / (double)links;
+    std::cout << name << ": chain " << per_link << " ns/link" << std::endl;
+  }
+
+  snmalloc::debug_check_empty<snmalloc::Alloc::Config>();
+}
@@ -9,6 +9,8 @@
 #include <test/opt.h>
 #include <sstream>
 #include <algorithm>
+#include <filesystem>
+#include <fstream>
 
 #include "cown_swapping/swapping_thread.h"
 #include "zipfian_distribution.h"
@@ -32,6 +34,10 @@ size_t INTER_ARRIVAL_NANOSECONDS;
 size_t INTER_ARRIVAL_STANDARD_DEVIATION;
 bool WRITE_TO_FILE;
 bool PRINT_MEMORY;
+bool READAHEAD;
+bool PREFETCH;
+size_t COMPRESSED_TIER_MB;
+size_t SAMPLE_INTERVAL_MS;
 std::atomic_char32_t behaviours_ran{0};
 char32_t final_behaviours_ran{0};
 uint64_t num_fetches{0};
@@ -103,6 +109,10 @@ void read_input(int argc, char *argv[])
   WRITE_TO_FILE = !opt.has("--DONT_SAVE");
 
   PRINT_MEMORY = opt.has("--PRINT_MEMORY");
+  READAHEAD = opt.has("--Readahead");
+  PREFETCH = opt.has("--Prefetch");
+  COMPRESSED_TIER_MB = opt.is<size_t>("--COMPRESSED_TIER_MB", 0);
+  SAMPLE_INTERVAL_MS = opt.is<size_t>("--SAMPLE_INTERVAL_MS", 10);
 
 
   std::cout << "Starting run with "
@@ -116,7 +126,10 @@ void read_input(int argc, char *argv[])
           << "THREAD_NUMBER: " << THREAD_NUMBER << ", "
           << "TOTAL_BEHAVIOURS: " << TOTAL_BEHAVIOURS << ", "
           << "INTER_ARRIVAL_NANOSECONDS: " << INTER_ARRIVAL_NANOSECONDS << ", "
-          << "INTER_ARRIVAL_STANDARD_DEVIATION: " << INTER_ARRIVAL_STANDARD_DEVIATION << std::endl;
+          << "INTER_ARRIVAL_STANDARD_DEVIATION: " << INTER_ARRIVAL_STANDARD_DEVIATION << ", "
+          << "READAHEAD: " << READAHEAD << ", "
+          << "PREFETCH: " << PREFETCH << ", "
+          << "COMPRESSED_TIER_MB: " << COMPRESSED_TIER_MB << std::endl;
 }
 
 class Body
@@ -138,27 +151,22 @@ public:
     return id;
   }
 
-  static Body *serialize(Body* body, std::iostream& archive)
+  // Swapped with the zero-copy interface, so the data is written and read in place.
+  static void gather(Body* body, std::vector<iovec>& buffers)
   {
-    if (body == nullptr)
-    {
-      size_t id;
-      size_t data_size;
-      archive.read((char *)&id, sizeof(id));
-      archive.read((char *)&data_size, sizeof(data_size));
-
-      assert(data_size == COWN_DATA_SIZE);
+    buffers.push_back({&body->id, sizeof(body->id)});
+    buffers.push_back({&body->data_size, sizeof(body->data_size)});
+    buffers.push_back({body->data, body->data_size});
+  }
 
-      char *data = new char[data_size];
-      archive.read(data, data_size);
-      return new Body(id, data_size, data);
-    }
+  static Body *scatter(size_t size, std::vector<iovec>& buffers)
+  {
+    size_t data_size = size - sizeof(Body::id) - sizeof(Body::data_size);
+    assert(data_size == COWN_DATA_SIZE);
 
-    archive.write((char*)&body->id, sizeof(body->id));
-    archive.write((char*)&body->data_size, sizeof(body->data_size));
-    archive.write(body->data, body->data_size);
-    
-    return nullptr;
+    auto body = new Body(0, data_size, new char[data_size]);
+    gather(body, buffers);
+    return body;
   }
 
   static size_t size(Body *body)
@@ -321,7 +329,14 @@ void test_body(std::vector<uint64_t>& latencies,
   sched.init(THREAD_NUMBER);
 
   if (!uninstrumented)
+  {
     CownMemoryThread::create(MEMORY_TARGET_MB, MULTIPLIER, SWAP_ALGO);
+    CownMemoryThread::set_sample_interval(std::chrono::milliseconds(SAMPLE_INTERVAL_MS));
+  }
+
+  ActualCownSwapper::set_readahead(READAHEAD);
+  ActualCownSwapper::set_correlation_prefetch(PREFETCH);
+  ActualCownSwapper::set_compressed_tier(COMPRESSED_TIER_MB * 1024 * 1024);
   
   std::vector<size_t> indices(COWN_NUMBER);
 
@@ -333,6 +348,10 @@ void test_body(std::vector<uint64_t>& latencies,
   sched.run();
   bs.join();
 
+  ActualCownSwapper::set_readahead(false);
+  ActualCownSwapper::set_correlation_prefetch(false);
+  ActualCownSwapper::set_compressed_tier(0);
+
   std::ofstream cs("cowns_accesses.txt");
   for (size_t i = 0; i < COWN_NUMBER; ++i)
   {